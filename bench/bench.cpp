@@ -0,0 +1,384 @@
+// Benchmark suite over a corpus of recorded mirai-http-api payloads, measuring
+// the throughput and the heap allocations per item of the decoding and encoding
+// paths. The results are written to stdout as JSON for tracking regressions.
+//
+// Usage: miraipp_bench [corpus directory]
+
+#include <mirai/mirai.h>
+#include <mirai/core/message/common.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+
+#ifdef MIRAIPP_SIMDJSON
+#define MIRAIPP_JSON_BACKEND_NAME "simdjson"
+#else
+#define MIRAIPP_JSON_BACKEND_NAME "builtin"
+#endif
+
+namespace
+{
+    std::atomic<size_t> allocation_count{ 0 };
+}
+
+// Count every allocation made through the global operator new, the array and
+// nothrow forms forward to this one
+void* operator new(const size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+    using namespace mirai;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr double min_seconds = 0.5; // Minimum timed duration of each benchmark
+
+    volatile size_t sink = 0; // Keeps the results alive
+
+    struct Result
+    {
+        std::string name;
+        size_t items = 0;
+        double seconds = 0;
+        size_t allocations = 0;
+    };
+
+    std::vector<Result> results;
+
+    // Run rounds of body until enough time is measured, calling setup before every
+    // round outside of the timing and the allocation counting
+    template <typename Setup, typename Body>
+    void measure(std::string name, const size_t items_per_round, Setup&& setup, Body&& body)
+    {
+        setup();
+        body(); // Warm up
+        Result result{ std::move(name) };
+        while (result.seconds < min_seconds)
+        {
+            setup();
+            const size_t allocations = allocation_count.load(std::memory_order_relaxed);
+            const auto begin = Clock::now();
+            body();
+            const std::chrono::duration<double> elapsed = Clock::now() - begin;
+            result.allocations += allocation_count.load(std::memory_order_relaxed) - allocations;
+            result.seconds += elapsed.count();
+            result.items += items_per_round;
+        }
+        std::cerr << result.name << ": " << double(result.items) / result.seconds << " items/s\n";
+        results.push_back(std::move(result));
+    }
+
+    template <typename Body>
+    void measure(std::string name, const size_t items_per_round, Body&& body)
+    {
+        measure(std::move(name), items_per_round, [] {}, std::forward<Body>(body));
+    }
+
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open corpus file " + path);
+        std::ostringstream oss;
+        oss << file.rdbuf();
+        return oss.str();
+    }
+
+    // Split a corpus file holding an array of payloads into the payload texts
+    std::vector<std::string> read_payloads(const std::string& path)
+    {
+        std::vector<std::string> payloads;
+        for (const auto& payload : utils::json::parse(read_file(path)))
+            payloads.push_back(payload.dump());
+        return payloads;
+    }
+
+    // The members of the decoded types, compared one by one by equal(), so that the
+    // library types don't need equality operators only for this check
+    auto fields(const Group& v) { return std::tie(v.id, v.name, v.permission); }
+    auto fields(const Member& v) { return std::tie(v.id, v.member_name, v.permission, v.group); }
+    auto fields(const Friend& v) { return std::tie(v.id, v.nickname, v.remark); }
+    auto fields(const ReceivedMessage& v) { return std::tie(v.source, v.quote, v.content); }
+    auto fields(const GroupMessage& v) { return std::tie(v.message, v.sender); }
+    auto fields(const FriendMessage& v) { return std::tie(v.message, v.sender); }
+    auto fields(const TempMessage& v) { return std::tie(v.message, v.sender); }
+    auto fields(const BotOnlineEvent& v) { return std::tie(v.qq); }
+    auto fields(const BotOfflineEventActive& v) { return std::tie(v.qq); }
+    auto fields(const BotOfflineEventForce& v) { return std::tie(v.qq); }
+    auto fields(const BotOfflineEventDropped& v) { return std::tie(v.qq); }
+    auto fields(const BotReloginEvent& v) { return std::tie(v.qq); }
+    auto fields(const GroupRecallEvent& v) { return std::tie(v.author_id, v.message_id, v.time, v.group, v.operator_); }
+    auto fields(const FriendRecallEvent& v) { return std::tie(v.author_id, v.message_id, v.time, v.operator_); }
+    auto fields(const BotGroupPermissionChangeEvent& v) { return std::tie(v.origin, v.current, v.group); }
+    auto fields(const BotMuteEvent& v) { return std::tie(v.duration, v.operator_); }
+    auto fields(const BotUnmuteEvent& v) { return std::tie(v.operator_); }
+    auto fields(const BotJoinGroupEvent& v) { return std::tie(v.group); }
+    auto fields(const BotLeaveEventActive& v) { return std::tie(v.group); }
+    auto fields(const BotLeaveEventKick& v) { return std::tie(v.group); }
+    auto fields(const GroupNameChangeEvent& v) { return std::tie(v.origin, v.current, v.group, v.operator_); }
+    auto fields(const GroupEntranceAnnouncementChangeEvent& v) { return std::tie(v.origin, v.current, v.group, v.operator_); }
+    auto fields(const GroupMuteAllEvent& v) { return std::tie(v.origin, v.current, v.group, v.operator_); }
+    auto fields(const GroupAllowAnonymousChatEvent& v) { return std::tie(v.origin, v.current, v.group, v.operator_); }
+    auto fields(const GroupAllowConfessTalkEvent& v) { return std::tie(v.origin, v.current, v.group, v.is_by_bot); }
+    auto fields(const GroupAllowMemberInviteEvent& v) { return std::tie(v.origin, v.current, v.group, v.operator_); }
+    auto fields(const MemberJoinEvent& v) { return std::tie(v.member); }
+    auto fields(const MemberLeaveEventKick& v) { return std::tie(v.member, v.operator_); }
+    auto fields(const MemberLeaveEventQuit& v) { return std::tie(v.member); }
+    auto fields(const MemberCardChangeEvent& v) { return std::tie(v.origin, v.current, v.member, v.operator_); }
+    auto fields(const MemberSpecialTitleChangeEvent& v) { return std::tie(v.origin, v.current, v.member); }
+    auto fields(const MemberPermissionChangeEvent& v) { return std::tie(v.origin, v.current, v.member); }
+    auto fields(const MemberMuteEvent& v) { return std::tie(v.duration, v.member, v.operator_); }
+    auto fields(const MemberUnmuteEvent& v) { return std::tie(v.member, v.operator_); }
+    auto fields(const NewFriendRequestEvent& v) { return std::tie(v.event_id, v.from_id, v.group_id, v.nick); }
+    auto fields(const MemberJoinRequestEvent& v) { return std::tie(v.event_id, v.from_id, v.group_id, v.group_name, v.nick); }
+
+    template <typename T, typename = void> struct has_fields : std::false_type {};
+    template <typename T>
+    struct has_fields<T, std::void_t<decltype(fields(std::declval<const T&>()))>> : std::true_type {};
+
+    template <typename T> bool equal(const std::optional<T>& lhs, const std::optional<T>& rhs);
+
+    template <typename T>
+    bool equal(const T& lhs, const T& rhs)
+    {
+        if constexpr (has_fields<T>::value)
+            return std::apply([&](const auto&... lhs_fields)
+            {
+                return std::apply([&](const auto&... rhs_fields)
+                {
+                    return (equal(lhs_fields, rhs_fields) && ...);
+                }, fields(rhs));
+            }, fields(lhs));
+        else
+            return lhs == rhs;
+    }
+
+    template <typename T>
+    bool equal(const std::optional<T>& lhs, const std::optional<T>& rhs)
+    {
+        return lhs.has_value() == rhs.has_value() && (!lhs || equal(*lhs, *rhs));
+    }
+
+    bool equal(const Event& lhs, const Event& rhs)
+    {
+        return lhs.type() == rhs.type() && lhs.apply([&](const auto& event)
+        {
+            return equal(event, rhs.get<std::decay_t<decltype(event)>>());
+        });
+    }
+
+    // Decoding into recycled storage must give the same event as decoding afresh,
+    // whichever event of the same type the storage held before, and decoding
+    // afresh must give the same event as nlohmann::json
+    bool check_recycled_decoding(const std::vector<std::string>& payloads)
+    {
+        bool passed = true;
+        const auto report = [&](const char* what, const std::string& payload, const std::string& previous)
+        {
+            std::cerr << what << " differs from parse_event for " << payload << '\n';
+            if (!previous.empty()) std::cerr << "  decoded after " << previous << '\n';
+            passed = false;
+        };
+        for (const std::string& payload : payloads)
+        {
+            const Event fresh = parse_event(payload);
+            if (!equal(utils::json::parse(payload).get<Event>(), fresh)) report("from_json(Event)", payload, {});
+            for (const std::string& previous : payloads)
+            {
+                EventStorage storage;
+                if (storage.decode(previous).type() != fresh.type()) continue;
+                if (!equal(storage.decode(payload), fresh)) report("EventStorage::decode", payload, previous);
+            }
+        }
+        return passed;
+    }
+
+    void write_results(const std::string& corpus)
+    {
+        utils::json benchmarks = utils::json::array();
+        for (const Result& result : results)
+            benchmarks.push_back({
+                { "name", result.name },
+                { "items_per_second", double(result.items) / result.seconds },
+                { "ns_per_item", result.seconds * 1e9 / double(result.items) },
+                { "allocations_per_item", double(result.allocations) / double(result.items) }
+            });
+        const utils::json output{
+            { "corpus", corpus },
+            { "json_backend", MIRAIPP_JSON_BACKEND_NAME },
+            { "benchmarks", std::move(benchmarks) }
+        };
+        std::cout << output.dump(4) << '\n';
+    }
+}
+
+int main(const int argc, const char* const argv[])
+{
+    const std::string corpus = argc > 1 ? argv[1] : MIRAIPP_BENCH_CORPUS;
+    const std::vector<std::string> events = read_payloads(corpus + "/events.json");
+    const std::vector<std::string> group_messages = read_payloads(corpus + "/group_messages.json");
+    const std::string member_list = read_file(corpus + "/member_list.json");
+
+    // Benchmarking wrong results is pointless, check the decoders against each other first
+    std::vector<std::string> all_events = events;
+    all_events.insert(all_events.end(), group_messages.begin(), group_messages.end());
+    if (!check_recycled_decoding(all_events)) return EXIT_FAILURE;
+
+    // Decoding events
+    std::vector<utils::json> event_json;
+    for (const std::string& event : events) event_json.push_back(utils::json::parse(event));
+    measure("from_json(Event)", events.size(), [&]
+    {
+        for (const utils::json& json : event_json) sink = sink + size_t(json.get<Event>().type());
+    });
+    measure("json::parse + from_json(Event)", events.size(), [&]
+    {
+        for (const std::string& event : events)
+            sink = sink + size_t(utils::json::parse(event).get<Event>().type());
+    });
+    measure("parse_event", events.size(), [&]
+    {
+        for (const std::string& event : events) sink = sink + size_t(parse_event(event).type());
+    });
+    EventStorage storage;
+    measure("EventStorage::decode", events.size(), [&]
+    {
+        for (const std::string& event : events) sink = sink + size_t(storage.decode(event).type());
+    });
+    measure("parse_event (group messages)", group_messages.size(), [&]
+    {
+        for (const std::string& message : group_messages) sink = sink + size_t(parse_event(message).type());
+    });
+    measure("LazyEvent::group_id (group messages)", group_messages.size(), [&]
+    {
+        for (const std::string& message : group_messages)
+            sink = sink + size_t(LazyEvent(message).group_id().value_or(mirai::gid_t()).id);
+    });
+
+    // Decoding a member list, counting members as the items
+    const size_t member_count = utils::json::parse(member_list).at("data").size();
+    measure("from_json(member list)", member_count, [&]
+    {
+        sink = sink + utils::json::parse(member_list).at("data").get<std::vector<Member>>().size();
+    });
+    measure("read_json(member list)", member_count, [&]
+    {
+        utils::JsonReader reader(member_list);
+        std::vector<Member> members;
+        reader.read_object([&](const std::string_view key)
+        {
+            if (key == "data") read_json(reader, members);
+            else reader.skip();
+        });
+        sink = sink + members.size();
+    });
+
+    // Encoding and manipulating messages
+    std::vector<Message> messages;
+    for (const std::string& message : group_messages)
+        messages.push_back(parse_event(message).get<GroupMessage>().message.content);
+    measure("to_json(Message) + dump", messages.size(), [&]
+    {
+        for (const Message& message : messages) sink = sink + utils::json(message).dump().size();
+    });
+    measure("write_json(Message)", messages.size(), [&]
+    {
+        for (const Message& message : messages)
+        {
+            std::string json;
+            utils::JsonWriter writer(json);
+            write_json(writer, message);
+            sink = sink + json.size();
+        }
+    });
+    measure("Message::stringify", messages.size(), [&]
+    {
+        for (const Message& message : messages) sink = sink + message.stringify().size();
+    });
+    std::vector<std::string> texts, escaped_texts;
+    for (const Message& message : messages)
+        for (const Segment& segment : message.chain())
+            if (is_plain(segment))
+            {
+                texts.push_back(segment.get<msg::Plain>().text);
+                escaped_texts.push_back(Message::escape(texts.back()));
+            }
+    measure("Message::escape", texts.size(), [&]
+    {
+        for (const std::string& text : texts) sink = sink + Message::escape(text).size();
+    });
+    measure("Message::unescape", escaped_texts.size(), [&]
+    {
+        for (const std::string& text : escaped_texts) sink = sink + Message::unescape(text).size();
+    });
+
+    // Combining chains whose plain segments are split at every character,
+    // the chains are rebuilt outside of the timing before every round
+    std::vector<MessageChain> split_chains;
+    for (const Message& message : messages)
+    {
+        MessageChain& chain = split_chains.emplace_back();
+        for (const Segment& segment : message.chain())
+        {
+            if (!is_plain(segment))
+            {
+                chain.push_back(segment);
+                continue;
+            }
+            for (const char ch : segment.get<msg::Plain>().text) chain.emplace_back(msg::Plain{ std::string(1, ch) });
+        }
+    }
+    std::vector<MessageChain> chains;
+    measure("combine_adjacent_text", split_chains.size(), [&] { chains = split_chains; }, [&]
+    {
+        for (MessageChain& chain : chains) combine_adjacent_text(chain);
+        sink = sink + chains.front().size();
+    });
+
+    // End to end dispatch of WebSocket frames to a subscriber, every round waits
+    // until the handlers have received all of its events, so that the handling on
+    // the pool threads is timed and its allocations are counted in the same round
+    {
+        auto transport = std::make_shared<LoopbackTransport>();
+        SessionSettings settings;
+        settings.transport = transport;
+        Session session("benchmark", mirai::uid_t(10000), settings);
+        std::mutex delivery_mutex;
+        std::condition_variable delivered_all;
+        size_t delivered = 0;
+        auto& connection = session.subscribe_all_events([&](Event& e)
+        {
+            sink = sink + size_t(e.type());
+            std::lock_guard lock(delivery_mutex);
+            if (++delivered == events.size()) delivered_all.notify_one();
+        }, [] { std::abort(); });
+        measure("dispatch via LoopbackTransport", events.size(), [&]
+        {
+            std::lock_guard lock(delivery_mutex);
+            delivered = 0;
+        }, [&]
+        {
+            for (const std::string& event : events) transport->push_event(event);
+            std::unique_lock lock(delivery_mutex);
+            delivered_all.wait(lock, [&] { return delivered == events.size(); });
+        });
+        session.close_connection(connection);
+    }
+
+    write_results(corpus);
+}
@@ -0,0 +1,76 @@
+// Measures the cost of decoding events, for the type dispatch alone and for
+// whole WebSocket payloads, comparing against a linear scan over the type names
+// and against the nlohmann::json DOM path
+
+#include <mirai/mirai.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+    const std::array payloads
+    {
+        R"({"type":"GroupMessage","messageChain":[{"type":"Source","id":12345,"time":1600000000},{"type":"At","target":10001,"display":"@bot"},{"type":"Plain","text":"Hello, world! This is a group message."},{"type":"Face","faceId":14,"name":"smile"}],"sender":{"id":10002,"memberName":"someone","permission":"MEMBER","group":{"id":20001,"name":"some group","permission":"ADMINISTRATOR"}}})",
+        R"({"type":"FriendMessage","messageChain":[{"type":"Source","id":12346,"time":1600000001},{"type":"Plain","text":"A friend message"}],"sender":{"id":10003,"nickname":"friend","remark":""}})",
+        R"({"type":"GroupNameChangeEvent","origin":"old name","current":"new name","group":{"id":20001,"name":"new name","permission":"ADMINISTRATOR"},"operator":null})",
+        R"({"type":"MemberMuteEvent","durationSeconds":600,"member":{"id":10004,"memberName":"muted","permission":"MEMBER","group":{"id":20001,"name":"some group","permission":"ADMINISTRATOR"}},"operator":{"id":10005,"memberName":"admin","permission":"OWNER","group":{"id":20001,"name":"some group","permission":"ADMINISTRATOR"}}})",
+        R"({"type":"MemberJoinRequestEvent","eventId":1234567890,"fromId":10006,"groupId":20001,"groupName":"some group","nick":"newcomer","message":""})"
+    };
+
+    const std::array<std::string_view, 9> type_names
+    {
+        "GroupMessage", "FriendMessage", "TempMessage", "BotReloginEvent", "GroupNameChangeEvent",
+        "MemberMuteEvent", "MemberUnmuteEvent", "NewFriendRequestEvent", "MemberJoinRequestEvent"
+    };
+
+    volatile size_t sink = 0; // Keeps the results alive
+
+    size_t linear_find(const std::string_view name)
+    {
+        for (size_t i = 0; i < mirai::event_type_names.size(); i++)
+            if (mirai::event_type_names[i] == name) return i;
+        return mirai::event_type_names.size();
+    }
+
+    template <typename F>
+    void measure(const std::string_view label, const size_t count, F&& func)
+    {
+        using Clock = std::chrono::steady_clock;
+        const size_t warm_up = count / 10;
+        for (size_t i = 0; i < warm_up; i++) func(i);
+        const auto begin = Clock::now();
+        for (size_t i = 0; i < count; i++) func(i);
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - begin;
+        std::cout << std::left << std::setw(32) << label
+            << std::right << std::setw(10) << std::fixed << std::setprecision(1)
+            << elapsed.count() / double(count) << " ns/op\n";
+    }
+}
+
+int main()
+{
+    constexpr size_t dispatch_count = 10'000'000;
+    constexpr size_t decode_count = 500'000;
+
+    std::cout << "Type dispatch\n";
+    measure("linear scan", dispatch_count, [](const size_t i)
+    {
+        sink = sink + linear_find(type_names[i % type_names.size()]);
+    });
+    measure("perfect hash", dispatch_count, [](const size_t i)
+    {
+        sink = sink + mirai::event_type_index.find(type_names[i % type_names.size()]);
+    });
+
+    std::cout << "Payload decode\n";
+    measure("nlohmann::json DOM", decode_count, [](const size_t i)
+    {
+        const auto json = mirai::utils::json::parse(payloads[i % payloads.size()]);
+        sink = sink + size_t(json.get<mirai::Event>().type());
+    });
+    measure("parse_event", decode_count, [](const size_t i)
+    {
+        sink = sink + size_t(mirai::parse_event(payloads[i % payloads.size()]).type());
+    });
+}
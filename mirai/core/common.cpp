@@ -1,14 +1,14 @@
 #include "common.h"
 #include <iostream>
-#include <cpr/parameters.h>
 #include "../utils/encoding.h"
 #include "../utils/request.h"
 
 namespace mirai
 {
-    std::string get_version()
+    std::string get_version(const std::string_view host)
     {
-        const auto res = utils::get("/about", cpr::Parameters{});
+        utils::HttpClient client(host, 1);
+        const auto res = utils::json::parse(client.get("/about"));
         utils::check_response(res);
         return res.at("data").at("version").get<std::string>();
     }
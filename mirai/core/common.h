@@ -6,7 +6,9 @@
 namespace mirai
 {
     /**
-     * \brief Base URL of all the HTTP requests
+     * \brief Default host of the mirai-http-api server
+     * \remarks This is only read when a SessionSettings object is constructed,
+     * every session uses the host in its own settings afterwards
      */
     inline std::string base_url = "localhost:8080";
 
@@ -18,11 +20,29 @@ namespace mirai
         using std::runtime_error::runtime_error;
     };
 
+    /**
+     * \brief Exception thrown when a request does not complete before its deadline
+     */
+    class TimeoutError : public RuntimeError
+    {
+        using RuntimeError::RuntimeError;
+    };
+
+    /**
+     * \brief Exception thrown when a request is rejected by an open circuit
+     * breaker without contacting the server
+     */
+    class CircuitOpenError : public RuntimeError
+    {
+        using RuntimeError::RuntimeError;
+    };
+
     /**
      * \brief Get the version of the Mirai HTTP API plugin
+     * \param host Host of the mirai-http-api server
      * \return The version string
      */
-    std::string get_version();
+    std::string get_version(std::string_view host = base_url);
 
     /**
      * \brief A simple error handler which logs every error to the console
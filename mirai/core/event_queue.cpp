@@ -0,0 +1,228 @@
+#include "event_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include "common.h"
+#include "../utils/json_reader.h"
+#include "../utils/string.h"
+
+namespace mirai
+{
+    namespace
+    {
+        std::string unique_spill_path(const std::string_view prefix)
+        {
+            std::string path(prefix);
+            if (path.empty())
+            {
+                std::error_code error;
+                const auto directory = std::filesystem::temp_directory_path(error);
+                if (error) throw RuntimeError(utils::strcat("Failed to find the temporary directory: ", error.message()));
+                path = (directory / "miraipp-events").string();
+            }
+            // Queues of different subscriptions and sessions may be given the same policy
+            static std::atomic<uint64_t> next_id{ 0 };
+            return utils::strcat(path, ".", std::to_string(next_id.fetch_add(1, std::memory_order_relaxed)));
+        }
+    }
+
+    EventQueue::EventQueue(const EventQueuePolicy& policy, utils::Executor& pool,
+        Handler handler, std::shared_ptr<ws::QueueCounters> counters):
+        policy_(policy), pool_(pool), handler_(std::move(handler)), counters_(std::move(counters)),
+        max_workers_(policy.max_workers != 0 ? policy.max_workers :
+            std::max<size_t>(std::thread::hardware_concurrency(), 1))
+    {
+        if (policy_.overflow != OverflowPolicy::spill) return;
+        spill_path_ = unique_spill_path(policy_.spill_path);
+        spill_writer_.open(spill_path_, std::ios::binary | std::ios::trunc);
+        spill_reader_.open(spill_path_, std::ios::binary);
+        if (!spill_writer_ || !spill_reader_)
+            throw RuntimeError(utils::strcat("Failed to create the spill file ", spill_path_));
+    }
+
+    EventQueue::~EventQueue() noexcept
+    {
+        close();
+        if (!spill_writer_.is_open()) return;
+        spill_writer_.close();
+        spill_reader_.close();
+        std::remove(spill_path_.c_str());
+    }
+
+    bool EventQueue::is_droppable(const Frame& frame) const
+    {
+        if (policy_.overflow != OverflowPolicy::drop_by_type) return false;
+        utils::JsonReader reader(frame->get_payload());
+        const size_t index = event_type_index.find(reader.peek_string_field("type"));
+        return index != event_type_index.npos && policy_.droppable_types.contains(EventType(index));
+    }
+
+    bool EventQueue::make_room(std::unique_lock<std::mutex>& lock, const bool droppable)
+    {
+        const auto drop = [&] { counters_->dropped.fetch_add(1, std::memory_order_relaxed); };
+        switch (policy_.overflow)
+        {
+            case OverflowPolicy::drop_oldest:
+                frames_.pop_front();
+                drop();
+                return true;
+            case OverflowPolicy::drop_by_type:
+            {
+                if (droppable)
+                {
+                    drop();
+                    return false;
+                }
+                const auto iter = std::find_if(frames_.begin(), frames_.end(),
+                    [](const Entry& entry) { return entry.droppable; });
+                if (iter != frames_.end())
+                {
+                    frames_.erase(iter);
+                    drop();
+                    return true;
+                }
+                break; // Nothing to drop, block
+            }
+            default: break;
+        }
+        not_full_.wait(lock, [&] { return closed_ || frames_.size() < policy_.capacity; });
+        return !closed_;
+    }
+
+    void EventQueue::spill(std::unique_lock<std::mutex>& lock, const Frame& frame)
+    {
+        spilling_++;
+        // Taken before releasing the queue, so that the records are written in order
+        std::unique_lock write_lock(write_mutex_);
+        lock.unlock();
+        // Records are the payload size on a line followed by the payload
+        const std::string& payload = frame->get_payload();
+        spill_writer_.seekp(write_pos_);
+        spill_writer_ << payload.size() << '\n';
+        spill_writer_.write(payload.data(), std::streamsize(payload.size()));
+        spill_writer_.flush(); // Make the record visible to the reader
+        const bool written = bool(spill_writer_);
+        if (written) write_pos_ = spill_writer_.tellp();
+        else spill_writer_.clear(); // The next record overwrites the partial one
+        const std::streamoff end = write_pos_;
+        write_lock.unlock();
+        lock.lock();
+        spilling_--;
+        if (!written)
+        {
+            counters_->dropped.fetch_add(1, std::memory_order_relaxed);
+            throw RuntimeError("Failed to write to the spill file");
+        }
+        spilled_++;
+        written_end_ = std::max(written_end_, end);
+        counters_->spilled.store(spilled_, std::memory_order_relaxed);
+        counters_->spilled_total.fetch_add(1, std::memory_order_relaxed);
+        // The workers that are still running read the record back
+        if (workers_ == 0) post_worker();
+    }
+
+    void EventQueue::read_back()
+    {
+        // Only the worker that has set reading_ touches the reader
+        using Message = Frame::element_type;
+        spill_reader_.clear();
+        spill_reader_.seekg(read_pos_);
+        size_t size = 0;
+        spill_reader_ >> size;
+        spill_reader_.ignore(1);
+        const auto frame = std::make_shared<Message>(nullptr, websocketpp::frame::opcode::text, 0);
+        std::string& payload = frame->get_raw_payload();
+        payload.resize(size);
+        spill_reader_.read(payload.data(), std::streamsize(size));
+        const bool read = bool(spill_reader_);
+        if (read) read_pos_ = spill_reader_.tellg();
+        std::lock_guard lock(mutex_);
+        reading_ = false;
+        if (read)
+        {
+            spilled_--;
+            frames_.push_back({ frame, false });
+            update_depth();
+        }
+        else
+        {
+            // The following records cannot be trusted either
+            counters_->dropped.fetch_add(spilled_, std::memory_order_relaxed);
+            spilled_ = 0;
+            read_pos_ = written_end_;
+        }
+        // Reuse the file from the beginning, no push is writing to it
+        if (spilled_ == 0 && spilling_ == 0) read_pos_ = write_pos_ = written_end_ = 0;
+        counters_->spilled.store(spilled_, std::memory_order_relaxed);
+        if (!read) throw RuntimeError("Failed to read from the spill file");
+    }
+
+    void EventQueue::post_worker()
+    {
+        workers_++;
+        pool_.post([self = shared_from_this()]() { self->drain(); });
+    }
+
+    void EventQueue::push(const Frame& frame)
+    {
+        const bool droppable = is_droppable(frame);
+        std::unique_lock lock(mutex_);
+        if (closed_) return;
+        // Once frames are spilled, the following ones go to the file as well to keep the order
+        if (policy_.overflow == OverflowPolicy::spill &&
+            (spilled_ != 0 || spilling_ != 0 || reading_ || frames_.size() >= policy_.capacity))
+        {
+            spill(lock, frame);
+            return;
+        }
+        if (frames_.size() >= policy_.capacity && !make_room(lock, droppable)) return;
+        frames_.push_back({ frame, droppable });
+        update_depth();
+        if (workers_ != max_workers_) post_worker();
+    }
+
+    void EventQueue::close()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+    }
+
+    void EventQueue::drain()
+    {
+        while (true)
+        {
+            Frame frame;
+            bool refill = false;
+            {
+                std::lock_guard lock(mutex_);
+                if (!frames_.empty())
+                {
+                    frame = std::move(frames_.front().frame);
+                    frames_.pop_front();
+                    update_depth();
+                }
+                // One worker at a time reads the spill file back, to keep the order
+                if (spilled_ != 0 && !reading_ && frames_.size() < policy_.capacity)
+                    refill = reading_ = true;
+                else if (!frame)
+                {
+                    workers_--;
+                    return;
+                }
+            }
+            if (refill)
+            {
+                try { read_back(); }
+                catch (...) { error_logger(); }
+            }
+            if (!frame) continue;
+            not_full_.notify_one();
+            handler_(frame);
+        }
+    }
+}
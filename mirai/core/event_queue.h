@@ -0,0 +1,148 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <fstream>
+#include "events.h"
+#include "websockets/connection.h"
+#include "../utils/executor.h"
+
+namespace mirai
+{
+    /**
+     * \brief What to do with the events received when the event queue is full
+     */
+    enum class OverflowPolicy
+    {
+        block, ///< Block the WebSocket thread until there is room, which stops reading from the socket
+        drop_oldest, ///< Drop the oldest queued event to make room
+        drop_by_type, ///< Drop the new event or the oldest queued one of the droppable types, block if there is none
+        spill ///< Write the events to a spill file, and read them back in order when there is room
+    };
+
+    /**
+     * \brief Policy of the queue between the WebSocket thread and the thread pool
+     * of the subscriptions using ExecutionPolicy::thread_pool
+     */
+    struct EventQueuePolicy final
+    {
+        size_t capacity = 0; ///< Maximum amount of events queued in memory, 0 for an unbounded queue
+        OverflowPolicy overflow = OverflowPolicy::block; ///< What to do with the events received when the queue is full
+        EventTypeSet droppable_types; ///< Types of the events that may be dropped with OverflowPolicy::drop_by_type
+        std::string spill_path; ///< Path prefix of the spill files with OverflowPolicy::spill, each queue appends a unique suffix to it, empty for the temporary directory
+        size_t max_workers = 0; ///< Maximum amount of pool threads handling the events at once, 0 for the hardware concurrency
+    };
+
+    /**
+     * \brief A bounded queue of WebSocket frames handled on a thread pool
+     * \details Frames pushed into the queue are handled by worker tasks posted to
+     * the pool, at most a configured amount of them at the same time. When the
+     * queue is full, the overflow policy decides the fate of the new frames. The
+     * queue depth and the drop counts are reported through the QueueCounters of
+     * the connection.
+     * \remarks The pool must outlive the queue. Queues are supposed to be owned
+     * by shared_ptrs, the worker tasks share the ownership.
+     */
+    class EventQueue final : public std::enable_shared_from_this<EventQueue>
+    {
+    public:
+        using Frame = ws::AsioClient::message_ptr;
+        using Handler = std::function<void(const Frame&)>;
+
+    private:
+        struct Entry
+        {
+            Frame frame;
+            bool droppable = false;
+        };
+
+        EventQueuePolicy policy_;
+        utils::Executor& pool_;
+        Handler handler_;
+        std::shared_ptr<ws::QueueCounters> counters_;
+        size_t max_workers_ = 0;
+        std::mutex mutex_;
+        std::condition_variable not_full_;
+        std::deque<Entry> frames_;
+        size_t workers_ = 0;
+        bool closed_ = false;
+        // The spill file is written by the pushes holding write_mutex_, which they take
+        // before releasing mutex_ to keep the order, and read by one worker at a time,
+        // so that the file I/O is done without holding mutex_
+        std::string spill_path_;
+        std::mutex write_mutex_;
+        std::ofstream spill_writer_;
+        std::ifstream spill_reader_;
+        std::streamoff write_pos_ = 0; // Guarded by write_mutex_
+        std::streamoff read_pos_ = 0; // Owned by the reading worker
+        std::streamoff written_end_ = 0; // End of the records written completely
+        size_t spilled_ = 0; // Records written completely and not read back
+        size_t spilling_ = 0; // Records being written
+        bool reading_ = false; // A worker is reading a record back
+
+        bool is_droppable(const Frame& frame) const;
+        bool make_room(std::unique_lock<std::mutex>& lock, bool droppable);
+        void spill(std::unique_lock<std::mutex>& lock, const Frame& frame);
+        void read_back();
+        void post_worker();
+        void update_depth() const { counters_->depth.store(frames_.size(), std::memory_order_relaxed); }
+        void drain();
+
+    public:
+        /**
+         * \brief Construct an event queue
+         * \param policy The queue policy, the capacity should not be 0
+         * \param pool The thread pool for handling the frames
+         * \param handler The handler of the frames, it should not throw
+         * \param counters The counters to report the queue state to
+         * \remarks Failing to create the spill file is reported by throwing RuntimeError.
+         * Failing to write a frame to the spill file drops the frame, and failing to read
+         * one back drops all the spilled frames, both count as dropped frames
+         */
+        EventQueue(const EventQueuePolicy& policy, utils::Executor& pool,
+            Handler handler, std::shared_ptr<ws::QueueCounters> counters);
+
+        /**
+         * \brief Event queues cannot be copied
+         */
+        EventQueue(const EventQueue&) = delete;
+
+        /**
+         * \brief Event queues cannot be moved
+         */
+        EventQueue(EventQueue&&) = delete;
+
+        /**
+         * \brief Event queues cannot be copied
+         */
+        EventQueue& operator=(const EventQueue&) = delete;
+
+        /**
+         * \brief Event queues cannot be moved
+         */
+        EventQueue& operator=(EventQueue&&) = delete;
+
+        /**
+         * \brief Close the queue and remove the spill file
+         */
+        ~EventQueue() noexcept;
+
+        /**
+         * \brief Push a frame into the queue
+         * \param frame The frame
+         * \remarks This function may block until there is room in the queue,
+         * depending on the overflow policy. Failing to spill the frame is reported
+         * by throwing RuntimeError
+         */
+        void push(const Frame& frame);
+
+        /**
+         * \brief Close the queue, frames pushed afterwards are discarded and
+         * blocked pushes return at once
+         * \remarks The frames already queued are still handled
+         */
+        void close();
+    };
+}
@@ -1,4 +1,5 @@
 #include "events.h"
+#include "common.h"
 
 namespace mirai
 {
@@ -8,43 +9,118 @@ namespace mirai
         json.at("sender").get_to(value.sender);
     }
 
+    void read_json(utils::JsonReader& reader, GroupMessage& value)
+    {
+        reader.read_object({ "messageChain", "sender" }, [&](const std::string_view key)
+        {
+            if (key == "messageChain") read_json(reader, value.message);
+            else if (key == "sender") read_json(reader, value.sender);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, FriendMessage& value)
     {
         json.at("messageChain").get_to(value.message);
         json.at("sender").get_to(value.sender);
     }
 
+    void read_json(utils::JsonReader& reader, FriendMessage& value)
+    {
+        reader.read_object({ "messageChain", "sender" }, [&](const std::string_view key)
+        {
+            if (key == "messageChain") read_json(reader, value.message);
+            else if (key == "sender") read_json(reader, value.sender);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, TempMessage& value)
     {
         json.at("messageChain").get_to(value.message);
         json.at("sender").get_to(value.sender);
     }
 
+    void read_json(utils::JsonReader& reader, TempMessage& value)
+    {
+        reader.read_object({ "messageChain", "sender" }, [&](const std::string_view key)
+        {
+            if (key == "messageChain") read_json(reader, value.message);
+            else if (key == "sender") read_json(reader, value.sender);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotOnlineEvent& value)
     {
         json.at("qq").get_to(value.qq);
     }
 
+    void read_json(utils::JsonReader& reader, BotOnlineEvent& value)
+    {
+        reader.read_object({ "qq" }, [&](const std::string_view key)
+        {
+            if (key == "qq") read_json(reader, value.qq);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotOfflineEventActive& value)
     {
         json.at("qq").get_to(value.qq);
     }
 
+    void read_json(utils::JsonReader& reader, BotOfflineEventActive& value)
+    {
+        reader.read_object({ "qq" }, [&](const std::string_view key)
+        {
+            if (key == "qq") read_json(reader, value.qq);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotOfflineEventForce& value)
     {
         json.at("qq").get_to(value.qq);
     }
 
+    void read_json(utils::JsonReader& reader, BotOfflineEventForce& value)
+    {
+        reader.read_object({ "qq" }, [&](const std::string_view key)
+        {
+            if (key == "qq") read_json(reader, value.qq);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotOfflineEventDropped& value)
     {
         json.at("qq").get_to(value.qq);
     }
 
+    void read_json(utils::JsonReader& reader, BotOfflineEventDropped& value)
+    {
+        reader.read_object({ "qq" }, [&](const std::string_view key)
+        {
+            if (key == "qq") read_json(reader, value.qq);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotReloginEvent& value)
     {
         json.at("qq").get_to(value.qq);
     }
 
+    void read_json(utils::JsonReader& reader, BotReloginEvent& value)
+    {
+        reader.read_object({ "qq" }, [&](const std::string_view key)
+        {
+            if (key == "qq") read_json(reader, value.qq);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupRecallEvent& value)
     {
         json.at("authorId").get_to(value.author_id);
@@ -54,6 +130,19 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupRecallEvent& value)
+    {
+        reader.read_object({ "authorId", "messageId", "time", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "authorId") read_json(reader, value.author_id);
+            else if (key == "messageId") read_json(reader, value.message_id);
+            else if (key == "time") read_json(reader, value.time);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, FriendRecallEvent& value)
     {
         json.at("authorId").get_to(value.author_id);
@@ -62,6 +151,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, FriendRecallEvent& value)
+    {
+        reader.read_object({ "authorId", "messageId", "time", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "authorId") read_json(reader, value.author_id);
+            else if (key == "messageId") read_json(reader, value.message_id);
+            else if (key == "time") read_json(reader, value.time);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotGroupPermissionChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -69,6 +170,17 @@ namespace mirai
         json.at("group").get_to(value.group);
     }
 
+    void read_json(utils::JsonReader& reader, BotGroupPermissionChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotMuteEvent& value)
     {
         uint32_t count;
@@ -77,26 +189,72 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, BotMuteEvent& value)
+    {
+        reader.read_object({ "durationSeconds", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "durationSeconds") value.duration = std::chrono::seconds(reader.read_int());
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotUnmuteEvent& value)
     {
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, BotUnmuteEvent& value)
+    {
+        reader.read_object({ "operator" }, [&](const std::string_view key)
+        {
+            if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotLeaveEventActive& value)
     {
         json.at("group").get_to(value.group);    
     }
 
+    void read_json(utils::JsonReader& reader, BotLeaveEventActive& value)
+    {
+        reader.read_object({ "group" }, [&](const std::string_view key)
+        {
+            if (key == "group") read_json(reader, value.group);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotLeaveEventKick& value)
     {
         json.at("group").get_to(value.group);
     }
 
+    void read_json(utils::JsonReader& reader, BotLeaveEventKick& value)
+    {
+        reader.read_object({ "group" }, [&](const std::string_view key)
+        {
+            if (key == "group") read_json(reader, value.group);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, BotJoinGroupEvent& value)
     {
         json.at("group").get_to(value.group);
     }
 
+    void read_json(utils::JsonReader& reader, BotJoinGroupEvent& value)
+    {
+        reader.read_object({ "group" }, [&](const std::string_view key)
+        {
+            if (key == "group") read_json(reader, value.group);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupNameChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -105,6 +263,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupNameChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupEntranceAnnouncementChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -113,6 +283,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupEntranceAnnouncementChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupMuteAllEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -121,6 +303,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupMuteAllEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupAllowAnonymousChatEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -129,6 +323,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupAllowAnonymousChatEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupAllowConfessTalkEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -137,6 +343,18 @@ namespace mirai
         json.at("isByBot").get_to(value.is_by_bot);
     }
 
+    void read_json(utils::JsonReader& reader, GroupAllowConfessTalkEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "isByBot" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "isByBot") read_json(reader, value.is_by_bot);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, GroupAllowMemberInviteEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -145,22 +363,62 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, GroupAllowMemberInviteEvent& value)
+    {
+        reader.read_object({ "origin", "current", "group", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "group") read_json(reader, value.group);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberJoinEvent& value)
     {
         json.at("member").get_to(value.member);
     }
 
+    void read_json(utils::JsonReader& reader, MemberJoinEvent& value)
+    {
+        reader.read_object({ "member" }, [&](const std::string_view key)
+        {
+            if (key == "member") read_json(reader, value.member);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberLeaveEventKick& value)
     {
         json.at("member").get_to(value.member);
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, MemberLeaveEventKick& value)
+    {
+        reader.read_object({ "member", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "member") read_json(reader, value.member);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberLeaveEventQuit& value)
     {
         json.at("member").get_to(value.member);
     }
 
+    void read_json(utils::JsonReader& reader, MemberLeaveEventQuit& value)
+    {
+        reader.read_object({ "member" }, [&](const std::string_view key)
+        {
+            if (key == "member") read_json(reader, value.member);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberCardChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -169,6 +427,18 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, MemberCardChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "member", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "member") read_json(reader, value.member);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberSpecialTitleChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -176,6 +446,17 @@ namespace mirai
         json.at("member").get_to(value.member);
     }
 
+    void read_json(utils::JsonReader& reader, MemberSpecialTitleChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "member" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "member") read_json(reader, value.member);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberPermissionChangeEvent& value)
     {
         json.at("origin").get_to(value.origin);
@@ -183,6 +464,17 @@ namespace mirai
         json.at("member").get_to(value.member);
     }
 
+    void read_json(utils::JsonReader& reader, MemberPermissionChangeEvent& value)
+    {
+        reader.read_object({ "origin", "current", "member" }, [&](const std::string_view key)
+        {
+            if (key == "origin") read_json(reader, value.origin);
+            else if (key == "current") read_json(reader, value.current);
+            else if (key == "member") read_json(reader, value.member);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberMuteEvent& value)
     {
         uint32_t count;
@@ -192,12 +484,33 @@ namespace mirai
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, MemberMuteEvent& value)
+    {
+        reader.read_object({ "durationSeconds", "member", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "durationSeconds") value.duration = std::chrono::seconds(reader.read_int());
+            else if (key == "member") read_json(reader, value.member);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberUnmuteEvent& value)
     {
         json.at("member").get_to(value.member);
         json.at("operator").get_to(value.operator_);
     }
 
+    void read_json(utils::JsonReader& reader, MemberUnmuteEvent& value)
+    {
+        reader.read_object({ "member", "operator" }, [&](const std::string_view key)
+        {
+            if (key == "member") read_json(reader, value.member);
+            else if (key == "operator") read_json(reader, value.operator_);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, NewFriendRequestEvent& value)
     {
         json.at("eventId").get_to(value.event_id);
@@ -207,6 +520,24 @@ namespace mirai
         json.at("nick").get_to(value.nick);
     }
 
+    void read_json(utils::JsonReader& reader, NewFriendRequestEvent& value)
+    {
+        reader.read_object({ "eventId", "fromId", "groupId", "nick" }, [&](const std::string_view key)
+        {
+            if (key == "eventId") read_json(reader, value.event_id);
+            else if (key == "fromId") read_json(reader, value.from_id);
+            else if (key == "groupId")
+            {
+                // Reset the group of a recycled request
+                const gid_t group_id = utils::read_json_value<gid_t>(reader);
+                if (group_id != 0) value.group_id = group_id;
+                else value.group_id = std::nullopt;
+            }
+            else if (key == "nick") read_json(reader, value.nick);
+            else reader.skip();
+        });
+    }
+
     void from_json(const utils::json& json, MemberJoinRequestEvent& value)
     {
         json.at("eventId").get_to(value.event_id);
@@ -216,16 +547,76 @@ namespace mirai
         json.at("groupName").get_to(value.group_name);
     }
 
+    void read_json(utils::JsonReader& reader, MemberJoinRequestEvent& value)
+    {
+        reader.read_object({ "eventId", "fromId", "groupId", "nick", "groupName" }, [&](const std::string_view key)
+        {
+            if (key == "eventId") read_json(reader, value.event_id);
+            else if (key == "fromId") read_json(reader, value.from_id);
+            else if (key == "groupId") read_json(reader, value.group_id);
+            else if (key == "nick") read_json(reader, value.nick);
+            else if (key == "groupName") read_json(reader, value.group_name);
+            else reader.skip();
+        });
+    }
+
     namespace
     {
+        template <size_t I>
+        void alternative_from_json(const utils::json& json, Event& value)
+        {
+            value = Event(json.get<std::variant_alternative_t<I, EventVariant>>());
+        }
+
+        template <size_t I>
+        void alternative_read_json(utils::JsonReader& reader, Event& value)
+        {
+            using Type = std::variant_alternative_t<I, EventVariant>;
+            if (Type* event = value.get_if<Type>()) // Reuse the storage of the event
+                read_json(reader, *event);
+            else
+                value = Event(utils::read_json_value<Type>(reader));
+        }
+
+        // Decoders are dispatched by looking up the type name in the perfect hash table
         template <size_t... I>
         void event_from_json_impl(const utils::json& json, Event& value,
             std::index_sequence<I...>)
         {
-            const std::string& type = json.at("type").get_ref<const std::string&>();
-            ((type == event_type_names[I]
-                  ? (void)(value = Event(json.get<std::variant_alternative_t<I, EventVariant>>()))
-                  : (void)0), ...);
+            using Decoder = void(*)(const utils::json&, Event&);
+            static constexpr Decoder decoders[]{ &alternative_from_json<I>... };
+            const size_t index = event_type_index.find(json.at("type").get_ref<const std::string&>());
+            if (index != event_type_index.npos) decoders[index](json, value);
+        }
+
+        template <size_t... I>
+        void event_read_json_impl(utils::JsonReader& reader, Event& value,
+            std::index_sequence<I...>)
+        {
+            using Decoder = void(*)(utils::JsonReader&, Event&);
+            static constexpr Decoder decoders[]{ &alternative_read_json<I>... };
+            const size_t index = event_type_index.find(reader.peek_string_field("type"));
+            if (index != event_type_index.npos)
+                decoders[index](reader, value);
+            else
+            {
+                value = Event(); // The same as the result of from_json
+                reader.skip();
+            }
+        }
+
+        // Payloads without a type are not events but error responses
+        [[noreturn]] void throw_error_response(utils::JsonReader& reader)
+        {
+            int32_t code = 0;
+            std::string message = "Missing event type";
+            reader.read_object([&](const std::string_view key)
+            {
+                if (key == "code") read_json(reader, code);
+                else if (key == "msg") read_json(reader, message);
+                else reader.skip();
+            });
+            throw RuntimeError(message);
         }
     }
 
@@ -234,4 +625,32 @@ namespace mirai
         event_from_json_impl(json, value,
             std::make_index_sequence<std::variant_size_v<EventVariant>>{});
     }
+
+    void read_json(utils::JsonReader& reader, Event& value)
+    {
+        event_read_json_impl(reader, value,
+            std::make_index_sequence<std::variant_size_v<EventVariant>>{});
+    }
+
+    Event parse_event(const std::string_view payload)
+    {
+        utils::JsonReader reader(payload);
+        Event event;
+        if (reader.peek_string_field("type").empty()) throw_error_response(reader);
+        read_json(reader, event);
+        reader.expect_end();
+        return event;
+    }
+
+    Event& EventStorage::decode(const std::string_view payload)
+    {
+        utils::JsonReader reader(payload);
+        const std::string_view type = reader.peek_string_field("type");
+        if (type.empty()) throw_error_response(reader);
+        std::optional<Event>& slot = events_[event_type_index.find(type)];
+        Event& event = slot ? *slot : slot.emplace();
+        read_json(reader, event);
+        reader.expect_end();
+        return event;
+    }
 }
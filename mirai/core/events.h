@@ -6,6 +6,7 @@
 #include "types.h"
 #include "message/received_message.h"
 #include "../utils/variant_wrapper.h"
+#include "../utils/name_index.h"
 #include "../utils/json_extensions.h"
 
 namespace mirai
@@ -334,37 +335,69 @@ namespace mirai
     };
 
     void from_json(const utils::json& json, GroupMessage& value);
+    void read_json(utils::JsonReader& reader, GroupMessage& value);
     void from_json(const utils::json& json, FriendMessage& value);
+    void read_json(utils::JsonReader& reader, FriendMessage& value);
     void from_json(const utils::json& json, TempMessage& value);
+    void read_json(utils::JsonReader& reader, TempMessage& value);
     void from_json(const utils::json& json, BotOnlineEvent& value);
+    void read_json(utils::JsonReader& reader, BotOnlineEvent& value);
     void from_json(const utils::json& json, BotOfflineEventActive& value);
+    void read_json(utils::JsonReader& reader, BotOfflineEventActive& value);
     void from_json(const utils::json& json, BotOfflineEventForce& value);
+    void read_json(utils::JsonReader& reader, BotOfflineEventForce& value);
     void from_json(const utils::json& json, BotOfflineEventDropped& value);
+    void read_json(utils::JsonReader& reader, BotOfflineEventDropped& value);
     void from_json(const utils::json& json, BotReloginEvent& value);
+    void read_json(utils::JsonReader& reader, BotReloginEvent& value);
     void from_json(const utils::json& json, GroupRecallEvent& value);
+    void read_json(utils::JsonReader& reader, GroupRecallEvent& value);
     void from_json(const utils::json& json, FriendRecallEvent& value);
+    void read_json(utils::JsonReader& reader, FriendRecallEvent& value);
     void from_json(const utils::json& json, BotGroupPermissionChangeEvent& value);
+    void read_json(utils::JsonReader& reader, BotGroupPermissionChangeEvent& value);
     void from_json(const utils::json& json, BotMuteEvent& value);
+    void read_json(utils::JsonReader& reader, BotMuteEvent& value);
     void from_json(const utils::json& json, BotUnmuteEvent& value);
+    void read_json(utils::JsonReader& reader, BotUnmuteEvent& value);
     void from_json(const utils::json& json, BotLeaveEventActive& value);
+    void read_json(utils::JsonReader& reader, BotLeaveEventActive& value);
     void from_json(const utils::json& json, BotLeaveEventKick& value);
+    void read_json(utils::JsonReader& reader, BotLeaveEventKick& value);
     void from_json(const utils::json& json, BotJoinGroupEvent& value);
+    void read_json(utils::JsonReader& reader, BotJoinGroupEvent& value);
     void from_json(const utils::json& json, GroupNameChangeEvent& value);
+    void read_json(utils::JsonReader& reader, GroupNameChangeEvent& value);
     void from_json(const utils::json& json, GroupEntranceAnnouncementChangeEvent& value);
+    void read_json(utils::JsonReader& reader, GroupEntranceAnnouncementChangeEvent& value);
     void from_json(const utils::json& json, GroupMuteAllEvent& value);
+    void read_json(utils::JsonReader& reader, GroupMuteAllEvent& value);
     void from_json(const utils::json& json, GroupAllowAnonymousChatEvent& value);
+    void read_json(utils::JsonReader& reader, GroupAllowAnonymousChatEvent& value);
     void from_json(const utils::json& json, GroupAllowConfessTalkEvent& value);
+    void read_json(utils::JsonReader& reader, GroupAllowConfessTalkEvent& value);
     void from_json(const utils::json& json, GroupAllowMemberInviteEvent& value);
+    void read_json(utils::JsonReader& reader, GroupAllowMemberInviteEvent& value);
     void from_json(const utils::json& json, MemberJoinEvent& value);
+    void read_json(utils::JsonReader& reader, MemberJoinEvent& value);
     void from_json(const utils::json& json, MemberLeaveEventKick& value);
+    void read_json(utils::JsonReader& reader, MemberLeaveEventKick& value);
     void from_json(const utils::json& json, MemberLeaveEventQuit& value);
+    void read_json(utils::JsonReader& reader, MemberLeaveEventQuit& value);
     void from_json(const utils::json& json, MemberCardChangeEvent& value);
+    void read_json(utils::JsonReader& reader, MemberCardChangeEvent& value);
     void from_json(const utils::json& json, MemberSpecialTitleChangeEvent& value);
+    void read_json(utils::JsonReader& reader, MemberSpecialTitleChangeEvent& value);
     void from_json(const utils::json& json, MemberPermissionChangeEvent& value);
+    void read_json(utils::JsonReader& reader, MemberPermissionChangeEvent& value);
     void from_json(const utils::json& json, MemberMuteEvent& value);
+    void read_json(utils::JsonReader& reader, MemberMuteEvent& value);
     void from_json(const utils::json& json, MemberUnmuteEvent& value);
+    void read_json(utils::JsonReader& reader, MemberUnmuteEvent& value);
     void from_json(const utils::json& json, NewFriendRequestEvent& value);
+    void read_json(utils::JsonReader& reader, NewFriendRequestEvent& value);
     void from_json(const utils::json& json, MemberJoinRequestEvent& value);
+    void read_json(utils::JsonReader& reader, MemberJoinRequestEvent& value);
 
     using EventVariant = std::variant<
         GroupMessage, FriendMessage, TempMessage,
@@ -397,19 +430,130 @@ namespace mirai
     static_assert(std::variant_size_v<EventVariant> == static_cast<size_t>(EventType::max_value),
         "Mismatched enum and variant size (Event)");
 
+    /**
+     * \brief A set of event types
+     */
+    class EventTypeSet final
+    {
+    private:
+        static_assert(static_cast<size_t>(EventType::max_value) <= 64, "Too many event types for EventTypeSet");
+        uint64_t bits_ = 0;
+
+        static constexpr uint64_t bit(const EventType type) { return uint64_t(1) << static_cast<size_t>(type); }
+    public:
+        /**
+         * \brief Construct an empty set
+         */
+        constexpr EventTypeSet() = default;
+
+        /**
+         * \brief Construct a set of some event types
+         * \param types The event types
+         */
+        constexpr EventTypeSet(const std::initializer_list<EventType> types)
+        {
+            for (const EventType type : types) bits_ |= bit(type);
+        }
+
+        /**
+         * \brief Get the set of all the event types
+         * \return The set
+         */
+        static constexpr EventTypeSet all()
+        {
+            EventTypeSet set;
+            set.bits_ = bit(EventType::max_value) - 1;
+            return set;
+        }
+
+        /**
+         * \brief Get the set of the message event types
+         * \return The set
+         */
+        static constexpr EventTypeSet messages()
+        {
+            return { EventType::group_message, EventType::friend_message, EventType::temp_message };
+        }
+
+        /**
+         * \brief Add an event type to the set
+         * \param type The event type
+         * \return Reference to this set
+         */
+        constexpr EventTypeSet& insert(const EventType type)
+        {
+            bits_ |= bit(type);
+            return *this;
+        }
+
+        /**
+         * \brief Remove an event type from the set
+         * \param type The event type
+         * \return Reference to this set
+         */
+        constexpr EventTypeSet& erase(const EventType type)
+        {
+            bits_ &= ~bit(type);
+            return *this;
+        }
+
+        /**
+         * \brief Check whether an event type is in the set
+         * \param type The event type
+         * \return The result
+         */
+        constexpr bool contains(const EventType type) const { return (bits_ & bit(type)) != 0; }
+
+        /**
+         * \brief Check whether the set is empty
+         * \return The result
+         */
+        constexpr bool empty() const { return bits_ == 0; }
+
+        /**
+         * \brief Check whether every event type in this set is also in another set
+         * \param other The other set
+         * \return The result
+         */
+        constexpr bool is_subset_of(const EventTypeSet other) const { return (bits_ & ~other.bits_) == 0; }
+
+        friend constexpr EventTypeSet operator|(EventTypeSet lhs, const EventTypeSet rhs)
+        {
+            lhs.bits_ |= rhs.bits_;
+            return lhs;
+        }
+        friend constexpr EventTypeSet operator&(EventTypeSet lhs, const EventTypeSet rhs)
+        {
+            lhs.bits_ &= rhs.bits_;
+            return lhs;
+        }
+        friend constexpr bool operator==(const EventTypeSet lhs, const EventTypeSet rhs) { return lhs.bits_ == rhs.bits_; }
+        friend constexpr bool operator!=(const EventTypeSet lhs, const EventTypeSet rhs) { return lhs.bits_ != rhs.bits_; }
+    };
+
     inline constexpr std::array<std::string_view, std::variant_size_v<EventVariant>> event_type_names
     {
         "GroupMessage", "FriendMessage", "TempMessage",
         "BotOnlineEvent", "BotOfflineEventActive", "BotOfflineEventForce", "BotOfflineEventDropped",
         "BotReloginEvent", "GroupRecallEvent", "FriendRecallEvent", "BotGroupPermissionChangeEvent",
-        "BotMuteEvent", "BotUnmuteEvent", "BotJoinGroupEvent", "GroupNameChangeEvent",
-        "GroupEntranceAnnouncementChangeEvent", "GroupMuteAllEvent", "GroupAllowAnonymousChatEvent",
-        "GroupAllowConfessTalkEvent", "GroupAllowMemberInviteEvent", "MemberJoinEvent",
-        "MemberLeaveEventKick", "MemberLeaveEventQuit", "MemberCardChangeEvent",
-        "MemberSpecialTitleChangeEvent", "MemberPermissionChangeEvent", "MemberMuteEvent",
-        "MemberUnmuteEvent", "NewFriendRequestEvent", "MemberJoinRequestEvent"
+        "BotMuteEvent", "BotUnmuteEvent", "BotJoinGroupEvent", "BotLeaveEventActive", "BotLeaveEventKick",
+        "GroupNameChangeEvent", "GroupEntranceAnnouncementChangeEvent", "GroupMuteAllEvent",
+        "GroupAllowAnonymousChatEvent", "GroupAllowConfessTalkEvent", "GroupAllowMemberInviteEvent",
+        "MemberJoinEvent", "MemberLeaveEventKick", "MemberLeaveEventQuit", "MemberCardChangeEvent",
+        "MemberSpecialTitleChangeEvent", "MemberPermissionChangeEvent", "MemberMuteEvent", "MemberUnmuteEvent",
+        "NewFriendRequestEvent", "MemberJoinRequestEvent"
     };
 
+    /**
+     * \brief Perfect hash table from the event type names to the EventType values
+     */
+    inline constexpr utils::NameIndex event_type_index{ event_type_names };
+
+    static_assert(event_type_index.find("GroupMessage") == size_t(EventType::group_message) &&
+        event_type_index.find("BotLeaveEventKick") == size_t(EventType::bot_leave_event_kick) &&
+        event_type_index.find("MemberJoinRequestEvent") == size_t(EventType::member_join_request_event),
+        "Mismatched enum and type names (Event)");
+
     /**
      * \brief The event type containing every kind of event,
      * plus the two message receiving "events"
@@ -417,4 +561,38 @@ namespace mirai
     using Event = utils::VariantWrapper<EventVariant, EventType>;
 
     void from_json(const utils::json& json, Event& value);
+    void read_json(utils::JsonReader& reader, Event& value);
+
+    /**
+     * \brief Decode an event pushed by the server in a single pass over the payload
+     * \param payload The JSON payload
+     * \return The event
+     * \remarks Error responses are reported by throwing RuntimeError
+     */
+    Event parse_event(std::string_view payload);
+
+    /**
+     * \brief Storage that events are decoded into, recycled from one event to another
+     * \details Every event type has its own slot. An event is decoded in place over
+     * the previous event of the same type, whose strings and vectors keep their
+     * capacity, so that in the steady state decoding an event seldom allocates.
+     * \remarks An event decoded is valid until the next event of the same type is
+     * decoded into the same storage. The storage is not thread safe, each thread
+     * needs its own.
+     */
+    class EventStorage final
+    {
+    private:
+        // One more slot for the events of unknown types
+        std::array<std::optional<Event>, std::variant_size_v<EventVariant> + 1> events_;
+
+    public:
+        /**
+         * \brief Decode an event pushed by the server into the storage
+         * \param payload The JSON payload
+         * \return Reference to the event in the storage
+         * \remarks Error responses are reported by throwing RuntimeError
+         */
+        Event& decode(std::string_view payload);
+    };
 }
@@ -0,0 +1,124 @@
+#include "lazy_event.h"
+
+namespace mirai
+{
+    namespace
+    {
+        // Read the group ID at the end of a path of keys through nested objects
+        std::optional<gid_t> read_group_id(utils::JsonReader& reader, const std::initializer_list<std::string_view> path)
+        {
+            for (const std::string_view key : path)
+                if (reader.peek() != utils::JsonReader::Kind::object || !reader.seek_key(key))
+                    return std::nullopt;
+            return utils::read_json_value<gid_t>(reader);
+        }
+
+        bool is_message_event(const EventType type)
+        {
+            return type == EventType::group_message
+                || type == EventType::friend_message
+                || type == EventType::temp_message;
+        }
+    }
+
+    LazyEvent::LazyEvent(std::shared_ptr<const std::string> payload): payload_(std::move(payload))
+    {
+        utils::JsonReader reader(*payload_);
+        const std::string_view type = reader.peek_string_field("type");
+        if (type.empty()) (void)parse_event(*payload_); // Not an event, let parse_event report the error
+        const size_t index = event_type_index.find(type);
+        if (index == event_type_index.npos)
+            throw RuntimeError(utils::strcat("Unknown event type ", type));
+        type_ = EventType(index);
+    }
+
+    LazyEvent::LazyEvent(std::string payload):
+        LazyEvent(std::make_shared<const std::string>(std::move(payload))) {}
+
+    std::string LazyEvent::raw(const std::string_view key) const
+    {
+        utils::JsonReader reader(*payload_);
+        if (!reader.seek_key(key)) return {};
+        return std::string(reader.read_raw());
+    }
+
+    std::optional<gid_t> LazyEvent::group_id() const
+    {
+        // A single pass over the members, an event has at most one of the keys
+        // that lead to a group besides the "groupId" in some request events
+        utils::JsonReader reader(*payload_);
+        reader.begin_object();
+        std::string_view key;
+        bool has_operator = false;
+        while (reader.next_key(key))
+        {
+            if (key == "group") return read_group_id(reader, { "id" });
+            if (key == "member" || key == "sender") return read_group_id(reader, { "group", "id" });
+            if (key == "groupId")
+            {
+                const auto group = utils::read_json_value<gid_t>(reader);
+                if (group != 0) return group;
+                continue;
+            }
+            if (key == "operator") has_operator = true;
+            reader.skip();
+        }
+        // Bot mute events only carry the group in the operator, which is a friend
+        // or null in other events, so it is the last resort
+        if (!has_operator) return std::nullopt;
+        utils::JsonReader operator_reader(*payload_);
+        operator_reader.seek_key("operator");
+        return read_group_id(operator_reader, { "group", "id" });
+    }
+
+    msgid_t LazyEvent::message_id() const
+    {
+        if (!is_message_event(type_)) throw RuntimeError("The event is not a message event");
+        utils::JsonReader reader(*payload_);
+        if (!reader.seek_key("messageChain")) throw RuntimeError("Missing message chain in the event");
+        msgid_t id;
+        bool found = false;
+        reader.begin_array();
+        while (reader.next_element())
+        {
+            // The source is always the first segment, the loop stops there
+            if (reader.peek_string_field("type") == "Source")
+            {
+                id = utils::read_json_value<msg::Source>(reader).id;
+                found = true;
+                break;
+            }
+            reader.skip();
+        }
+        if (!found) throw RuntimeError("Missing message source in the event");
+        return id;
+    }
+
+    ReceivedMessage& LazyEvent::message()
+    {
+        if (!is_message_event(type_)) throw RuntimeError("The event is not a message event");
+        if (event_)
+        {
+            switch (type_)
+            {
+                case EventType::group_message: return event_->get<GroupMessage>().message;
+                case EventType::friend_message: return event_->get<FriendMessage>().message;
+                default: return event_->get<TempMessage>().message;
+            }
+        }
+        if (!message_) message_ = decode<ReceivedMessage>("messageChain");
+        return *message_;
+    }
+
+    ReceivedMessageView LazyEvent::message_view() const
+    {
+        if (!is_message_event(type_)) throw RuntimeError("The event is not a message event");
+        return ReceivedMessageView(payload_);
+    }
+
+    Event& LazyEvent::event()
+    {
+        if (!event_) event_ = parse_event(*payload_);
+        return *event_;
+    }
+}
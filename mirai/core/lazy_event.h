@@ -0,0 +1,144 @@
+#pragma once
+
+#include <memory>
+#include "events.h"
+#include "common.h"
+#include "message/message_view.h"
+#include "../utils/string.h"
+
+namespace mirai
+{
+    /**
+     * \brief An event decoded lazily from its payload
+     * \details Only the type of the event is read when a lazy event is constructed.
+     * Sub-objects are decoded when they are first accessed, e.g. the message of
+     * a message event is not decoded if only the group ID is looked at. The whole
+     * event can be materialized into an Event, after which the lazy event behaves
+     * like the Event. <br>
+     * Subscribing with a callback taking a LazyEvent& instead of an Event& opts
+     * in to lazy decoding.
+     * \remarks The accessors that cache their results are not thread safe,
+     * a lazy event must not be accessed from multiple threads at the same time.
+     */
+    class LazyEvent final
+    {
+    private:
+        std::shared_ptr<const std::string> payload_;
+        EventType type_{};
+        std::optional<ReceivedMessage> message_;
+        std::optional<Event> event_;
+
+    public:
+        /**
+         * \brief Construct a lazy event from a payload
+         * \param payload The JSON payload, shared instead of copied
+         * \remarks Error responses and events of unknown types are reported by
+         * throwing RuntimeError
+         */
+        explicit LazyEvent(std::shared_ptr<const std::string> payload);
+
+        /**
+         * \brief Construct a lazy event from a payload
+         * \param payload The JSON payload
+         * \remarks Error responses and events of unknown types are reported by
+         * throwing RuntimeError
+         */
+        explicit LazyEvent(std::string payload);
+
+        /**
+         * \brief Get the type of the event
+         * \return The type
+         */
+        EventType type() const { return type_; }
+
+        /**
+         * \brief Get the JSON payload of the event
+         * \return The payload
+         */
+        std::string_view payload() const { return *payload_; }
+
+        /**
+         * \brief Get the raw JSON text of a member of the event object
+         * \param key The key of the member, e.g. "sender"
+         * \return The raw text, which is minified with the simdjson backend,
+         * empty if there is no such member
+         */
+        std::string raw(std::string_view key) const;
+
+        /**
+         * \brief Decode a member of the event object, without caching the result
+         * \tparam T Type of the member
+         * \param key The key of the member, e.g. "sender"
+         * \return The decoded member
+         */
+        template <typename T>
+        T decode(const std::string_view key) const
+        {
+            utils::JsonReader reader(*payload_);
+            if (!reader.seek_key(key)) throw RuntimeError(utils::strcat("Missing member \"", key, "\" in the event"));
+            return utils::read_json_value<T>(reader);
+        }
+
+        /**
+         * \brief Get the ID of the group related to the event without decoding it
+         * \details The ID is found in the "group" member or the group of the
+         * "member" or "sender" member, or in a "groupId" member, and failing
+         * those in the group of the "operator" member
+         * \return The group ID, or std::nullopt if the event is not related to a group
+         */
+        std::optional<gid_t> group_id() const;
+
+        /**
+         * \brief Get the ID of the message of a message event, without decoding
+         * the rest of the message chain
+         * \return The message ID
+         */
+        msgid_t message_id() const;
+
+        /**
+         * \brief Get the message of a message event, decoded on first access
+         * \return Reference to the message, which is the one in the materialized
+         * event if the whole event is decoded
+         */
+        ReceivedMessage& message();
+
+        /**
+         * \brief Get a view of the message of a message event, whose strings point
+         * into the payload instead of being copied, decoded every time this is called
+         * \return The view, which shares the payload with this lazy event
+         */
+        ReceivedMessageView message_view() const;
+
+        /**
+         * \brief Check whether the whole event is decoded
+         * \return The result
+         */
+        bool materialized() const { return event_.has_value(); }
+
+        /**
+         * \brief Decode the whole event, or get the event decoded before
+         * \return Reference to the event
+         */
+        Event& event();
+
+        /**
+         * \brief Get the event as a certain type, decoding the whole event
+         * \tparam T The type
+         * \return Reference to the event
+         */
+        template <typename T> T& get() { return event().get<T>(); }
+
+        /**
+         * \brief Get a pointer to the event if it is of a certain type, decoding
+         * the whole event if it is
+         * \tparam T The type
+         * \return Pointer to the event, nullptr if the type is not T
+         */
+        template <typename T>
+        T* get_if()
+        {
+            if (type_ != Event::type_of<T>()) return nullptr;
+            return &get<T>();
+        }
+    };
+}
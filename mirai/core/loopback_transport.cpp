@@ -0,0 +1,195 @@
+#include "loopback_transport.h"
+#include <thread>
+#include <algorithm>
+#include "common.h"
+#include "../utils/string.h"
+
+namespace mirai
+{
+    namespace
+    {
+        constexpr std::string_view success = R"({"code":0,"msg":"success"})";
+        constexpr std::string_view empty_events = R"({"code":0,"msg":"","data":[]})";
+    }
+
+    std::string LoopbackTransport::handle(const LoopbackRequest& request)
+    {
+        requests_++;
+        {
+            std::shared_lock lock(handler_mutex_);
+            const HandlerMap& handlers = request.method == HttpMethod::get ? get_handlers_ : post_handlers_;
+            if (const auto iter = handlers.find(request.url); iter != handlers.end())
+            {
+                try { return iter->second(request); }
+                catch (...)
+                {
+                    failures_++;
+                    throw;
+                }
+            }
+        }
+        failures_++;
+        throw RuntimeError("HTTP status code 404");
+    }
+
+    LoopbackTransport::LoopbackTransport(const size_t concurrency):
+        concurrency_(concurrency != 0 ? concurrency : std::max(std::thread::hardware_concurrency(), 1u))
+    {
+        using namespace std::literals;
+        const auto respond = [this](const HttpMethod method, const std::string_view url, const std::string_view response)
+        {
+            set_response(method, url, std::string(response));
+        };
+        const auto send_message = [this](const LoopbackRequest&)
+        {
+            return utils::strcat(R"({"code":0,"msg":"success","messageId":)",
+                std::to_string(++last_message_id_), "}");
+        };
+
+        respond(HttpMethod::get, "/about", R"({"code":0,"data":{"version":"loopback"}})");
+        respond(HttpMethod::get, "/countMessage", R"({"code":0,"msg":"","data":0})");
+        for (const auto url : { "/fetchMessage"sv, "/fetchLatestMessage"sv, "/peekMessage"sv, "/peekLatestMessage"sv })
+            respond(HttpMethod::get, url, empty_events);
+        respond(HttpMethod::get, "/messageFromId", R"({"code":5,"msg":"Message not found"})");
+        for (const auto url : { "/friendList"sv, "/groupList"sv, "/memberList"sv })
+            respond(HttpMethod::get, url, "[]");
+        respond(HttpMethod::get, "/groupConfig", R"({"name":"","announcement":"","confessTalk":false,)"
+            R"("allowMemberInvite":false,"autoApprove":false,"anonymousChat":false})");
+        respond(HttpMethod::get, "/memberInfo", R"({"name":"","specialTitle":""})");
+        respond(HttpMethod::get, "/config", R"({"cacheSize":4096,"enableWebsocket":false})");
+
+        respond(HttpMethod::post, "/auth", R"({"code":0,"session":"loopback"})");
+        for (const auto url : { "/sendFriendMessage"sv, "/sendTempMessage"sv, "/sendGroupMessage"sv })
+            set_handler(HttpMethod::post, url, send_message);
+        respond(HttpMethod::post, "/sendImageMessage", "[]");
+        respond(HttpMethod::post, "/uploadImage", R"({"imageId":"{00000000-0000-0000-0000-000000000000}.mirai",)"
+            R"("url":"","path":""})");
+        for (const auto url : {
+                 "/verify"sv, "/release"sv, "/recall"sv, "/muteAll"sv, "/unmuteAll"sv, "/mute"sv, "/unmute"sv,
+                 "/kick"sv, "/quit"sv, "/resp/newFriendRequestEvent"sv, "/resp/memberJoinRequestEvent"sv,
+                 "/groupConfig"sv, "/memberInfo"sv, "/config"sv })
+            respond(HttpMethod::post, url, success);
+    }
+
+    void LoopbackTransport::set_handler(const HttpMethod method, const std::string_view url, Handler handler)
+    {
+        std::unique_lock lock(handler_mutex_);
+        HandlerMap& handlers = method == HttpMethod::get ? get_handlers_ : post_handlers_;
+        if (!handler)
+        {
+            if (const auto iter = handlers.find(url); iter != handlers.end())
+                handlers.erase(iter);
+            return;
+        }
+        handlers.insert_or_assign(std::string(url), std::move(handler));
+    }
+
+    void LoopbackTransport::set_response(const HttpMethod method, const std::string_view url, std::string response)
+    {
+        set_handler(method, url, [response = std::move(response)](const LoopbackRequest&) { return response; });
+    }
+
+    size_t LoopbackTransport::push_event(std::string payload, const std::string_view channel)
+    {
+        // Build the frame once and share it among the connections, just like
+        // the WebSocket client hands the same message pointer to the callbacks
+        using Message = ws::AsioClient::message_ptr::element_type;
+        const auto message = std::make_shared<Message>(nullptr, websocketpp::frame::opcode::text, 0);
+        message->get_raw_payload() = std::move(payload);
+        size_t delivered = 0;
+        std::lock_guard lock(connection_mutex_);
+        push_depth_++;
+        // Index based loop since callbacks may open new connections, closed ones
+        // are kept until the loop is done since a callback may close its own connection
+        for (size_t i = 0; i < connections_.size(); i++)
+        {
+            ws::Connection& connection = *connections_[i];
+            if (connection.status() != ws::Status::open) continue;
+            if (!channel.empty())
+            {
+                const std::string_view uri = connection.uri();
+                const std::string_view path = uri.substr(0, uri.find('?'));
+                if (path != channel) continue;
+            }
+            try { connection.on_message(connection.handle(), message); }
+            catch (...)
+            {
+                if (--push_depth_ == 0) erase_closed_connections();
+                throw;
+            }
+            delivered++;
+        }
+        if (--push_depth_ == 0) erase_closed_connections();
+        return delivered;
+    }
+
+    void LoopbackTransport::erase_closed_connections()
+    {
+        const auto iter = std::remove_if(connections_.begin(), connections_.end(),
+            [](const std::unique_ptr<ws::Connection>& connection) { return connection->ended(); });
+        connections_.erase(iter, connections_.end());
+    }
+
+    std::string LoopbackTransport::get(const std::string_view url,
+        const utils::ArrayProxy<utils::QueryParameter> parameters)
+    {
+        LoopbackRequest request;
+        request.method = HttpMethod::get;
+        request.url = url;
+        request.parameters = parameters;
+        return handle(request);
+    }
+
+    std::string LoopbackTransport::post_json(const std::string_view url,
+        const std::string_view body, bool)
+    {
+        LoopbackRequest request;
+        request.method = HttpMethod::post;
+        request.url = url;
+        request.body = body;
+        return handle(request);
+    }
+
+    std::string LoopbackTransport::post_multipart(const std::string_view url,
+        const utils::ArrayProxy<utils::FormField> fields)
+    {
+        LoopbackRequest request;
+        request.method = HttpMethod::post;
+        request.url = url;
+        request.fields = fields;
+        return handle(request);
+    }
+
+    utils::RequestStats LoopbackTransport::request_stats() const
+    {
+        utils::RequestStats stats;
+        stats.requests = requests_;
+        stats.failures = failures_;
+        return stats;
+    }
+
+    ws::Connection& LoopbackTransport::connect(const std::string_view url)
+    {
+        std::lock_guard lock(connection_mutex_);
+        auto& connection = *connections_.emplace_back(
+            std::make_unique<ws::Connection>(websocketpp::connection_hdl{}, url));
+        connection.on_open("loopback");
+        websocket_started_ = true;
+        return connection;
+    }
+
+    void LoopbackTransport::close(ws::Connection& connection)
+    {
+        std::lock_guard lock(connection_mutex_);
+        connection.on_close();
+        if (push_depth_ == 0) erase_closed_connections();
+    }
+
+    void LoopbackTransport::close_websocket()
+    {
+        std::lock_guard lock(connection_mutex_);
+        for (const auto& connection : connections_) connection->on_close();
+        connections_.clear();
+        websocket_started_ = false;
+    }
+}
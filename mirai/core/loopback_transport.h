@@ -0,0 +1,110 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <functional>
+#include "transport.h"
+
+namespace mirai
+{
+    /**
+     * \brief HTTP method of a request
+     */
+    enum class HttpMethod { get, post };
+
+    /**
+     * \brief A request received by a loopback transport
+     */
+    struct LoopbackRequest final
+    {
+        HttpMethod method = HttpMethod::get; ///< Method of the request
+        std::string_view url; ///< The URL, e.g. "/friendList"
+        utils::ArrayProxy<utils::QueryParameter> parameters; ///< Query parameters of a GET request
+        std::string_view body; ///< JSON body of a POST request, empty for multipart requests
+        utils::ArrayProxy<utils::FormField> fields; ///< Fields of a multipart POST request
+    };
+
+    /**
+     * \brief An in-process transport answering mirai-http-api endpoints from memory
+     * \details Every endpoint the session uses is answered with a canned successful
+     * response by default, handlers can be replaced to return any other response.
+     * Requests to unknown endpoints fail like a server responding with status 404.
+     * Events are pushed to the opened WebSocket connections on the calling thread,
+     * in the same way the WebSocket client thread delivers frames. <br>
+     * This transport is meant for testing and benchmarking the library without a
+     * server, it measures the overhead of the library separately from the network.
+     */
+    class LoopbackTransport final : public Transport
+    {
+    public:
+        /**
+         * \brief Type of an endpoint handler, which returns the response text
+         * or throws RuntimeError to fail the request
+         */
+        using Handler = std::function<std::string(const LoopbackRequest&)>;
+
+    private:
+        using HandlerMap = std::map<std::string, Handler, std::less<>>;
+
+        size_t concurrency_ = 0;
+        mutable std::shared_mutex handler_mutex_;
+        HandlerMap get_handlers_;
+        HandlerMap post_handlers_;
+        std::atomic<uint64_t> requests_{ 0 };
+        std::atomic<uint64_t> failures_{ 0 };
+        std::atomic<int32_t> last_message_id_{ 0 };
+        std::recursive_mutex connection_mutex_;
+        std::vector<std::unique_ptr<ws::Connection>> connections_;
+        size_t push_depth_ = 0; // Nesting level of push_event, guarded by the connection mutex
+        std::atomic<bool> websocket_started_{ false };
+
+        std::string handle(const LoopbackRequest& request);
+        void erase_closed_connections();
+    public:
+        /**
+         * \brief Construct a loopback transport with the default handlers
+         * \param concurrency Amount of requests handled at the same time,
+         * 0 for the hardware concurrency
+         */
+        explicit LoopbackTransport(size_t concurrency = 0);
+
+        /**
+         * \brief Set the handler of an endpoint
+         * \param method The HTTP method
+         * \param url The URL of the endpoint, e.g. "/friendList"
+         * \param handler The handler, an empty handler removes the endpoint
+         */
+        void set_handler(HttpMethod method, std::string_view url, Handler handler);
+
+        /**
+         * \brief Answer an endpoint with a fixed response
+         * \param method The HTTP method
+         * \param url The URL of the endpoint, e.g. "/friendList"
+         * \param response The response text
+         */
+        void set_response(HttpMethod method, std::string_view url, std::string response);
+
+        /**
+         * \brief Push an event to the open WebSocket connections
+         * \param payload The payload of the frame, usually an event JSON object
+         * \param channel The URL the connections are connected to, e.g. "/all",
+         * leave empty to push to all the connections
+         * \return Amount of connections the event is delivered to
+         * \remarks Do not close the WebSocket side of the transport while pushing.
+         * Connections closed by the callbacks are released after the event is pushed.
+         */
+        size_t push_event(std::string payload, std::string_view channel = {});
+
+        std::string get(std::string_view url, utils::ArrayProxy<utils::QueryParameter> parameters) override;
+        std::string post_json(std::string_view url, std::string_view body, bool idempotent) override;
+        std::string post_multipart(std::string_view url, utils::ArrayProxy<utils::FormField> fields) override;
+        size_t concurrency() const override { return concurrency_; }
+        utils::RequestStats request_stats() const override;
+        ws::Connection& connect(std::string_view url) override;
+        void close(ws::Connection& connection) override;
+        void close_websocket() override;
+        bool websocket_started() const override { return websocket_started_; }
+    };
+}
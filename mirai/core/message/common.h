@@ -1,6 +1,7 @@
 #pragma once
 
 #include "segment.h"
+#include "../../utils/name_index.h"
 
 // This header file is not API
 
@@ -12,6 +13,12 @@ namespace mirai
         "FlashImage", "Xml", "Json", "App", "Poke"
     };
 
+    inline constexpr utils::NameIndex msg_type_index{ msg_type_names };
+
+    static_assert(msg_type_index.find("At") == size_t(SegmentType::at) &&
+        msg_type_index.find("Poke") == size_t(SegmentType::poke),
+        "Mismatched enum and type names (Segment)");
+
     inline bool is_plain(const Segment& node) { return node.type() == SegmentType::plain; }
 
     inline std::string& get_plain(Segment& node) { return node.get<msg::Plain>().text; }
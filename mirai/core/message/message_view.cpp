@@ -0,0 +1,217 @@
+#include "message_view.h"
+#include <functional>
+#include <utility>
+#include "common.h"
+#include "../common.h"
+
+namespace mirai
+{
+    namespace msg
+    {
+        namespace
+        {
+            std::optional<std::string> to_owned(const std::optional<std::string_view>& str)
+            {
+                if (!str) return std::nullopt;
+                return std::string(*str);
+            }
+        }
+
+        At AtView::to_owned() const
+        {
+            At at(target);
+            at.display = display;
+            return at;
+        }
+
+        Face FaceView::to_owned() const { return { face_id, msg::to_owned(name) }; }
+
+        Image ImageView::to_owned() const
+        {
+            return { msg::to_owned(image_id), msg::to_owned(url), msg::to_owned(path) };
+        }
+
+        FlashImage FlashImageView::to_owned() const
+        {
+            return { msg::to_owned(image_id), msg::to_owned(url), msg::to_owned(path) };
+        }
+    }
+
+    Message MessageView::to_owned() const
+    {
+        MessageChain owned;
+        owned.reserve(chain.size());
+        for (const SegmentView& segment : chain)
+            segment.apply([&owned](const auto& view) { owned.emplace_back(view.to_owned()); });
+        return Message(std::move(owned));
+    }
+
+    namespace
+    {
+        // Decodes the views, borrowing the strings from the payload whenever possible
+        class ViewDecoder final
+        {
+        private:
+            utils::JsonReader& reader_;
+            std::string_view payload_;
+            std::forward_list<std::string>& unescaped_;
+
+            // Whether a string read lies in the payload, instead of in the scratch
+            // storage of the reader which is overwritten by the next read
+            bool in_payload(const std::string_view str) const
+            {
+                const std::less<const char*> less;
+                return !less(str.data(), payload_.data())
+                    && !less(payload_.data() + payload_.size(), str.data() + str.size());
+            }
+
+            std::string_view read_string()
+            {
+                const std::string_view str = reader_.read_string();
+                if (in_payload(str)) return str;
+                return unescaped_.emplace_front(str);
+            }
+
+            std::optional<std::string_view> read_optional_string()
+            {
+                if (reader_.read_null()) return std::nullopt;
+                return read_string();
+            }
+
+            template <typename T>
+            T read_image()
+            {
+                T image;
+                reader_.read_object([&](const std::string_view key)
+                {
+                    if (key == "imageId") image.image_id = read_optional_string();
+                    else if (key == "url") image.url = read_optional_string();
+                    else if (key == "path") image.path = read_optional_string();
+                    else reader_.skip();
+                });
+                return image;
+            }
+
+            // Read an object with a single string member
+            template <typename T>
+            T read_text(const std::string_view member)
+            {
+                std::string_view text;
+                reader_.read_object([&](const std::string_view key)
+                {
+                    if (key == member) text = read_string();
+                    else reader_.skip();
+                });
+                return { text };
+            }
+
+        public:
+            ViewDecoder(utils::JsonReader& reader, const std::string_view payload,
+                std::forward_list<std::string>& unescaped):
+                reader_(reader), payload_(payload), unescaped_(unescaped) {}
+
+            // Read a segment, or skip it and return std::nullopt if its type is unknown
+            std::optional<SegmentView> read_segment()
+            {
+                switch (SegmentType(msg_type_index.find(reader_.peek_string_field("type"))))
+                {
+                    case SegmentType::at:
+                    {
+                        msg::AtView at;
+                        reader_.read_object([&](const std::string_view key)
+                        {
+                            if (key == "target") read_json(reader_, at.target);
+                            else if (key == "display") at.display = read_string();
+                            else reader_.skip();
+                        });
+                        return at;
+                    }
+                    case SegmentType::at_all: reader_.skip(); return msg::AtAllView{};
+                    case SegmentType::face:
+                    {
+                        msg::FaceView face;
+                        reader_.read_object([&](const std::string_view key)
+                        {
+                            if (key == "faceId") read_json(reader_, face.face_id);
+                            else if (key == "name") face.name = read_optional_string();
+                            else reader_.skip();
+                        });
+                        return face;
+                    }
+                    case SegmentType::plain: return read_text<msg::PlainView>("text");
+                    case SegmentType::image: return read_image<msg::ImageView>();
+                    case SegmentType::flash_image: return read_image<msg::FlashImageView>();
+                    case SegmentType::xml: return read_text<msg::XmlView>("xml");
+                    case SegmentType::json: return read_text<msg::JsonView>("json");
+                    case SegmentType::app: return read_text<msg::AppView>("content");
+                    case SegmentType::poke: return read_text<msg::PokeView>("name");
+                    default:
+                        reader_.skip();
+                        return std::nullopt;
+                }
+            }
+
+            // Read the origin of a quote, dropping the leading At with target = 0 like Quote does
+            void read_origin(MessageView& origin)
+            {
+                bool first = true;
+                reader_.read_array([&]
+                {
+                    const bool leading = std::exchange(first, false);
+                    auto segment = read_segment();
+                    if (!segment) return;
+                    if (const auto* at = segment->get_if<msg::AtView>(); leading && at && at->target == 0) return;
+                    origin.chain.emplace_back(std::move(*segment));
+                });
+            }
+
+            void read_quote(msg::QuoteView& quote)
+            {
+                reader_.read_object([&](const std::string_view key)
+                {
+                    if (key == "id") read_json(reader_, quote.id);
+                    else if (key == "groupId") read_json(reader_, quote.group_id);
+                    else if (key == "senderId") read_json(reader_, quote.sender_id);
+                    else if (key == "origin") read_origin(quote.origin);
+                    else reader_.skip();
+                });
+            }
+        };
+    }
+
+    ReceivedMessageView::ReceivedMessageView(std::shared_ptr<const std::string> payload):
+        payload_(std::move(payload))
+    {
+        utils::JsonReader reader(*payload_);
+        if (!reader.seek_key("messageChain")) throw RuntimeError("Missing message chain in the event");
+        ViewDecoder decoder(reader, *payload_, unescaped_);
+        bool extra_at = false; // Quote messages contains an extra At following the quote
+        reader.read_array([&]
+        {
+            const std::string_view type = reader.peek_string_field("type");
+            if (type == "Source")
+                read_json(reader, source_);
+            else if (type == "Quote")
+            {
+                decoder.read_quote(quote_.emplace());
+                extra_at = true;
+            }
+            else if (extra_at)
+            {
+                reader.skip();
+                extra_at = false;
+            }
+            else if (auto segment = decoder.read_segment())
+                content_.chain.emplace_back(std::move(*segment));
+        });
+    }
+
+    ReceivedMessage ReceivedMessageView::to_owned() const
+    {
+        ReceivedMessage message;
+        message.source = source_;
+        if (quote_) message.quote = quote_->to_owned();
+        message.content = content_.to_owned();
+        return message;
+    }
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <memory>
+#include <forward_list>
+#include "received_message.h"
+
+namespace mirai
+{
+    namespace msg
+    {
+        /**
+         * \brief A borrowed view of an At segment
+         */
+        struct AtView final
+        {
+            uid_t target; ///< Mentioned group member ID
+            std::string_view display; ///< The string for display the @ message
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            At to_owned() const;
+        };
+
+        /**
+         * \brief A borrowed view of an AtAll segment
+         */
+        struct AtAllView final
+        {
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            AtAll to_owned() const { return {}; }
+        };
+
+        /**
+         * \brief A borrowed view of a Face segment
+         */
+        struct FaceView final
+        {
+            std::optional<int32_t> face_id = 0; ///< The ID of the emoji
+            std::optional<std::string_view> name; ///< The name of the emoji
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Face to_owned() const;
+        };
+
+        /**
+         * \brief A borrowed view of a Plain segment
+         */
+        struct PlainView final
+        {
+            std::string_view text; ///< The text
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Plain to_owned() const { return { std::string(text) }; }
+        };
+
+        /**
+         * \brief A borrowed view of an Image segment
+         */
+        struct ImageView final
+        {
+            std::optional<std::string_view> image_id; ///< The ID of the image
+            std::optional<std::string_view> url; ///< The URL of the image
+            std::optional<std::string_view> path; ///< The relative path to "plugins/MiraiAPIHTTP/images" of a local image
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Image to_owned() const;
+        };
+
+        /**
+         * \brief A borrowed view of a FlashImage segment
+         */
+        struct FlashImageView final
+        {
+            std::optional<std::string_view> image_id; ///< The ID of the image
+            std::optional<std::string_view> url; ///< The URL of the image
+            std::optional<std::string_view> path; ///< The relative path to "plugins/MiraiAPIHTTP/images" of a local image
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            FlashImage to_owned() const;
+        };
+
+        /**
+         * \brief A borrowed view of an Xml segment
+         */
+        struct XmlView final
+        {
+            std::string_view xml; ///< The XML text
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Xml to_owned() const { return { std::string(xml) }; }
+        };
+
+        /**
+         * \brief A borrowed view of a Json segment
+         */
+        struct JsonView final
+        {
+            std::string_view json; ///< The json text
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Json to_owned() const { return { std::string(json) }; }
+        };
+
+        /**
+         * \brief A borrowed view of an App segment
+         */
+        struct AppView final
+        {
+            std::string_view content; ///< The content
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            App to_owned() const { return { std::string(content) }; }
+        };
+
+        /**
+         * \brief A borrowed view of a Poke segment
+         */
+        struct PokeView final
+        {
+            std::string_view name; ///< Type of the poke message
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Poke to_owned() const { return { std::string(name) }; }
+        };
+
+        using ViewVariant = std::variant<AtView, AtAllView, FaceView, PlainView, ImageView,
+            FlashImageView, XmlView, JsonView, AppView, PokeView>;
+    }
+
+    static_assert(std::variant_size_v<msg::ViewVariant> == std::variant_size_v<msg::Variant>,
+        "Mismatched segment and view variant size");
+
+    /**
+     * \brief A borrowed view of a segment in the message chain, the alternatives
+     * are in the same order as the ones of Segment
+     */
+    using SegmentView = utils::VariantWrapper<msg::ViewVariant, SegmentType>;
+
+    /**
+     * \brief A borrowed view of a message
+     */
+    struct MessageView final
+    {
+        std::vector<SegmentView> chain; ///< Views of the segments
+
+        /**
+         * \brief Copy the message out of the view
+         * \return The message
+         */
+        Message to_owned() const;
+    };
+
+    namespace msg
+    {
+        /**
+         * \brief A borrowed view of a Quote segment
+         */
+        struct QuoteView final
+        {
+            msgid_t id; ///< The ID of the message being quoted
+            gid_t group_id; ///< The group from which the quoted message is sent (group message)
+            uid_t sender_id; ///< The sender of the quoted message (friend message)
+            MessageView origin; ///< The original quoted message
+
+            /**
+             * \brief Copy the segment out of the view
+             * \return The segment
+             */
+            Quote to_owned() const { return { id, group_id, sender_id, origin.to_owned() }; }
+        };
+    }
+
+    /**
+     * \brief A borrowed view of a received message, whose strings point into the
+     * retained JSON payload of the event instead of being copied out
+     * \details The view shares the ownership of the payload, so the views in it
+     * stay valid as long as the ReceivedMessageView lives. Strings that cannot be
+     * viewed in the payload, i.e. the ones with escape sequences, are unescaped
+     * into storage owned by the view. With the simdjson backend every string is
+     * unescaped by the parser, thus copied into that storage. <br>
+     * Call to_owned() to keep the message beyond the lifetime of the view.
+     */
+    class ReceivedMessageView final
+    {
+    private:
+        std::shared_ptr<const std::string> payload_;
+        std::forward_list<std::string> unescaped_; // Nodes never move, so views into them stay valid
+        msg::Source source_;
+        std::optional<msg::QuoteView> quote_;
+        MessageView content_;
+
+    public:
+        /**
+         * \brief Decode the message chain of a message event into views
+         * \param payload The JSON payload of the message event
+         * \remarks Payloads without a message chain are reported by throwing
+         * RuntimeError
+         */
+        explicit ReceivedMessageView(std::shared_ptr<const std::string> payload);
+
+        /**
+         * \brief Copy constructor is deleted, views in the copy would refer to
+         * storage owned by the original
+         */
+        ReceivedMessageView(const ReceivedMessageView&) = delete;
+
+        /**
+         * \brief Copy assignment operator is deleted, views in the copy would
+         * refer to storage owned by the original
+         */
+        ReceivedMessageView& operator=(const ReceivedMessageView&) = delete;
+
+        /**
+         * \brief Move constructor, the views are still valid after moving
+         */
+        ReceivedMessageView(ReceivedMessageView&&) noexcept = default;
+
+        /**
+         * \brief Move assignment operator, the views are still valid after moving
+         * \return Reference to this object
+         */
+        ReceivedMessageView& operator=(ReceivedMessageView&&) noexcept = default;
+
+        /**
+         * \brief Free the storage of the view, and release the payload
+         */
+        ~ReceivedMessageView() noexcept = default;
+
+        /**
+         * \brief Get the JSON payload that the views point into
+         * \return The payload
+         */
+        std::string_view payload() const { return *payload_; }
+
+        /**
+         * \brief Get the source of the message
+         * \return The source
+         */
+        const msg::Source& source() const { return source_; }
+
+        /**
+         * \brief Get the quotation of the message
+         * \return The quotation, std::nullopt if the message quotes nothing
+         */
+        const std::optional<msg::QuoteView>& quote() const { return quote_; }
+
+        /**
+         * \brief Get the real message content
+         * \return The content
+         */
+        const MessageView& content() const { return content_; }
+
+        /**
+         * \brief Copy the message out of the view
+         * \return The message
+         */
+        ReceivedMessage to_owned() const;
+    };
+}
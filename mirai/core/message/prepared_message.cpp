@@ -0,0 +1,12 @@
+#include "prepared_message.h"
+
+namespace mirai
+{
+    PreparedMessage::PreparedMessage(const Message& message)
+    {
+        std::string json;
+        utils::JsonWriter writer(json);
+        write_json(writer, message);
+        chain_json_ = std::make_shared<const std::string>(std::move(json));
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include "segment.h"
+
+namespace mirai
+{
+    /**
+     * \brief A message whose message chain is encoded into JSON once, for sending
+     * constant content like help texts or menus repeatedly
+     * \details Sending a prepared message splices the encoded chain into the
+     * request body as is, so the message is not serialized again for every send.
+     * The encoded chain is immutable and shared by the copies of a prepared
+     * message, copying one is cheap.
+     */
+    class PreparedMessage final
+    {
+    private:
+        std::shared_ptr<const std::string> chain_json_;
+
+    public:
+        /**
+         * \brief Encode the message chain of a message
+         * \param message The message
+         */
+        explicit PreparedMessage(const Message& message);
+
+        /**
+         * \brief Get the encoded message chain
+         * \return The JSON array of the message chain
+         */
+        std::string_view chain_json() const { return *chain_json_; }
+    };
+
+    inline void write_json(utils::JsonWriter& writer, const PreparedMessage& value) { writer.write_raw(value.chain_json()); }
+}
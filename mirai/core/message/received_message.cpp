@@ -17,4 +17,42 @@ namespace mirai
         if (value.quote) chain.erase(chain.begin()); // Quote messages contains an extra At
         value.content = std::move(chain);
     }
+
+    void read_json(utils::JsonReader& reader, ReceivedMessage& value)
+    {
+        // The segments are read in place, so that a recycled message keeps its storage
+        MessageChain& chain = value.content.chain();
+        size_t size = 0;
+        bool sourced = false;
+        bool quoted = false;
+        bool extra_at = false; // Quote messages contains an extra At following the quote
+        reader.read_array([&]
+        {
+            const std::string_view type = reader.peek_string_field("type");
+            if (type == "Source")
+            {
+                read_json(reader, value.source);
+                sourced = true;
+            }
+            else if (type == "Quote")
+            {
+                read_json(reader, value.quote ? *value.quote : value.quote.emplace());
+                quoted = extra_at = true;
+            }
+            else if (extra_at)
+            {
+                reader.skip();
+                extra_at = false;
+            }
+            else
+            {
+                read_json(reader, size < chain.size() ? chain[size] : chain.emplace_back());
+                size++;
+            }
+        });
+        chain.resize(size);
+        // Reset what a recycled message may still hold from the previous one
+        if (!sourced) value.source = {};
+        if (!quoted) value.quote.reset();
+    }
 }
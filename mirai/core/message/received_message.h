@@ -15,4 +15,5 @@ namespace mirai
     };
 
     void from_json(const utils::json& json, ReceivedMessage& value);
+    void read_json(utils::JsonReader& reader, ReceivedMessage& value);
 }
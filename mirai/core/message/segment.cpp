@@ -1,11 +1,50 @@
 #include "segment.h"
 #include <sstream>
+#include <utility>
 #include "common.h"
 
 namespace mirai
 {
     namespace msg
     {
+        namespace
+        {
+            // This is an issue where there's an At segment with target = 0 at the beginning
+            void remove_leading_empty_at(Message& origin)
+            {
+                if (origin.empty()) return;
+                auto& chain = origin.chain();
+                if (chain.front().type() == SegmentType::at)
+                {
+                    const At& at = chain.front().get<At>();
+                    if (at.target == 0) chain.erase(chain.begin());
+                }
+            }
+
+            // Read the origin in place, dropping the leading At with target = 0
+            // while reading instead of erasing it afterwards
+            void read_origin(utils::JsonReader& reader, Message& origin)
+            {
+                auto& chain = origin.chain();
+                size_t size = 0;
+                bool first = true;
+                reader.read_array([&]
+                {
+                    Segment& segment = size < chain.size() ? chain[size] : chain.emplace_back();
+                    if (std::exchange(first, false) && reader.peek_string_field("type") == "At")
+                    {
+                        At at = utils::read_json_value<At>(reader);
+                        if (at.target == 0) return;
+                        segment = Segment(std::move(at));
+                    }
+                    else
+                        read_json(reader, segment);
+                    size++;
+                });
+                chain.resize(size);
+            }
+        }
+
         std::string At::stringify() const
         {
             std::ostringstream oss;
@@ -86,6 +125,27 @@ namespace mirai
             json.at("time").get_to(value.time);
         }
 
+        void read_json(utils::JsonReader& reader, Source& value)
+        {
+            reader.read_object({ "id", "time" }, [&](const std::string_view key)
+            {
+                if (key == "id") read_json(reader, value.id);
+                else if (key == "time") read_json(reader, value.time);
+                else reader.skip();
+            });
+        }
+
+        // The write_json overloads write the members with sorted keys, so that the
+        // output is the same as dumping the nlohmann::json built by to_json
+        void write_json(utils::JsonWriter& writer, const Source& value)
+        {
+            writer.begin_object();
+            writer.write_field("id", value.id);
+            writer.write_field("time", value.time);
+            writer.write_field("type", "Source");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Quote& value)
         {
             json = {
@@ -103,16 +163,30 @@ namespace mirai
             json.at("groupId").get_to(value.group_id);
             json.at("senderId").get_to(value.sender_id);
             json.at("origin").get_to(value.origin);
-            // This is an issue where there's an At segment with target = 0 at the beginning
-            if (!value.origin.empty())
+            remove_leading_empty_at(value.origin);
+        }
+
+        void read_json(utils::JsonReader& reader, Quote& value)
+        {
+            reader.read_object({ "id", "groupId", "senderId", "origin" }, [&](const std::string_view key)
             {
-                auto& chain = value.origin.chain();
-                if (chain.front().type() == SegmentType::at)
-                {
-                    const At& at = chain.front().get<At>();
-                    if (at.target == 0) chain.erase(chain.begin());
-                }
-            }
+                if (key == "id") read_json(reader, value.id);
+                else if (key == "groupId") read_json(reader, value.group_id);
+                else if (key == "senderId") read_json(reader, value.sender_id);
+                else if (key == "origin") read_origin(reader, value.origin);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Quote& value)
+        {
+            writer.begin_object();
+            writer.write_field("groupId", value.group_id);
+            writer.write_field("id", value.id);
+            writer.write_field("origin", value.origin);
+            writer.write_field("senderId", value.sender_id);
+            writer.write_field("type", "Quote");
+            writer.end_object();
         }
 
         void to_json(utils::json& json, const At& value)
@@ -130,6 +204,25 @@ namespace mirai
             json.at("display").get_to(value.display);
         }
 
+        void read_json(utils::JsonReader& reader, At& value)
+        {
+            reader.read_object({ "target", "display" }, [&](const std::string_view key)
+            {
+                if (key == "target") read_json(reader, value.target);
+                else if (key == "display") read_json(reader, value.display);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const At& value)
+        {
+            writer.begin_object();
+            writer.write_field("display", value.display);
+            writer.write_field("target", value.target);
+            writer.write_field("type", "At");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const AtAll&)
         {
             json = {
@@ -139,6 +232,15 @@ namespace mirai
 
         void from_json(const utils::json&, AtAll&) {}
 
+        void read_json(utils::JsonReader& reader, AtAll&) { reader.skip(); }
+
+        void write_json(utils::JsonWriter& writer, const AtAll&)
+        {
+            writer.begin_object();
+            writer.write_field("type", "AtAll");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Face& value)
         {
             json = {
@@ -154,6 +256,25 @@ namespace mirai
             json.at("name").get_to(value.name);
         }
 
+        void read_json(utils::JsonReader& reader, Face& value)
+        {
+            reader.read_object({ "faceId", "name" }, [&](const std::string_view key)
+            {
+                if (key == "faceId") read_json(reader, value.face_id);
+                else if (key == "name") read_json(reader, value.name);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Face& value)
+        {
+            writer.begin_object();
+            writer.write_field("faceId", value.face_id);
+            writer.write_field("name", value.name);
+            writer.write_field("type", "Face");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Plain& value)
         {
             json = {
@@ -167,6 +288,23 @@ namespace mirai
             json.at("text").get_to(value.text);
         }
 
+        void read_json(utils::JsonReader& reader, Plain& value)
+        {
+            reader.read_object({ "text" }, [&](const std::string_view key)
+            {
+                if (key == "text") read_json(reader, value.text);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Plain& value)
+        {
+            writer.begin_object();
+            writer.write_field("text", value.text);
+            writer.write_field("type", "Plain");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Image& value)
         {
             json = {
@@ -184,6 +322,27 @@ namespace mirai
             json.at("path").get_to(value.path);
         }
 
+        void read_json(utils::JsonReader& reader, Image& value)
+        {
+            reader.read_object({ "imageId", "url", "path" }, [&](const std::string_view key)
+            {
+                if (key == "imageId") read_json(reader, value.image_id);
+                else if (key == "url") read_json(reader, value.url);
+                else if (key == "path") read_json(reader, value.path);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Image& value)
+        {
+            writer.begin_object();
+            writer.write_field("imageId", value.image_id);
+            writer.write_field("path", value.path);
+            writer.write_field("type", "Image");
+            writer.write_field("url", value.url);
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const FlashImage& value)
         {
             json = {
@@ -201,6 +360,27 @@ namespace mirai
             json.at("path").get_to(value.path);
         }
 
+        void read_json(utils::JsonReader& reader, FlashImage& value)
+        {
+            reader.read_object({ "imageId", "url", "path" }, [&](const std::string_view key)
+            {
+                if (key == "imageId") read_json(reader, value.image_id);
+                else if (key == "url") read_json(reader, value.url);
+                else if (key == "path") read_json(reader, value.path);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const FlashImage& value)
+        {
+            writer.begin_object();
+            writer.write_field("imageId", value.image_id);
+            writer.write_field("path", value.path);
+            writer.write_field("type", "Image");
+            writer.write_field("url", value.url);
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Xml& value)
         {
             json = {
@@ -214,6 +394,23 @@ namespace mirai
             json.at("xml").get_to(value.xml);
         }
 
+        void read_json(utils::JsonReader& reader, Xml& value)
+        {
+            reader.read_object({ "xml" }, [&](const std::string_view key)
+            {
+                if (key == "xml") read_json(reader, value.xml);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Xml& value)
+        {
+            writer.begin_object();
+            writer.write_field("type", "Xml");
+            writer.write_field("xml", value.xml);
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Json& value)
         {
             json = {
@@ -227,6 +424,23 @@ namespace mirai
             json.at("json").get_to(value.json);
         }
 
+        void read_json(utils::JsonReader& reader, Json& value)
+        {
+            reader.read_object({ "json" }, [&](const std::string_view key)
+            {
+                if (key == "json") read_json(reader, value.json);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Json& value)
+        {
+            writer.begin_object();
+            writer.write_field("json", value.json);
+            writer.write_field("type", "Json");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const App& value)
         {
             json = {
@@ -240,6 +454,23 @@ namespace mirai
             json.at("content").get_to(value.content);
         }
 
+        void read_json(utils::JsonReader& reader, App& value)
+        {
+            reader.read_object({ "content" }, [&](const std::string_view key)
+            {
+                if (key == "content") read_json(reader, value.content);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const App& value)
+        {
+            writer.begin_object();
+            writer.write_field("content", value.content);
+            writer.write_field("type", "App");
+            writer.end_object();
+        }
+
         void to_json(utils::json& json, const Poke& value)
         {
             json = {
@@ -252,18 +483,67 @@ namespace mirai
         {
             json.at("name").get_to(value.name);
         }
+
+        void read_json(utils::JsonReader& reader, Poke& value)
+        {
+            reader.read_object({ "name" }, [&](const std::string_view key)
+            {
+                if (key == "name") read_json(reader, value.name);
+                else reader.skip();
+            });
+        }
+
+        void write_json(utils::JsonWriter& writer, const Poke& value)
+        {
+            writer.begin_object();
+            writer.write_field("name", value.name);
+            writer.write_field("type", "Poke");
+            writer.end_object();
+        }
     }
 
     namespace
     {
+        template <size_t I>
+        void alternative_from_json(const utils::json& json, Segment& value)
+        {
+            value = Segment(json.get<std::variant_alternative_t<I, msg::Variant>>());
+        }
+
+        template <size_t I>
+        void alternative_read_json(utils::JsonReader& reader, Segment& value)
+        {
+            using Type = std::variant_alternative_t<I, msg::Variant>;
+            if (Type* segment = value.get_if<Type>()) // Reuse the storage of the segment
+                read_json(reader, *segment);
+            else
+                value = Segment(utils::read_json_value<Type>(reader));
+        }
+
         template <size_t... I>
         void node_from_json_impl(const utils::json& json, Segment& value,
             std::index_sequence<I...>)
         {
-            const std::string& type = json.at("type").get_ref<const std::string&>();
-            ((type == msg_type_names[I]
-                  ? (void)(value = Segment(json.get<std::variant_alternative_t<I, msg::Variant>>()))
-                  : (void)0), ...);
+            using Decoder = void(*)(const utils::json&, Segment&);
+            static constexpr Decoder decoders[]{ &alternative_from_json<I>... };
+            const size_t index = msg_type_index.find(json.at("type").get_ref<const std::string&>());
+            if (index != msg_type_index.npos) decoders[index](json, value);
+        }
+
+        template <size_t... I>
+        void node_read_json_impl(utils::JsonReader& reader, Segment& value,
+            std::index_sequence<I...>)
+        {
+            using Decoder = void(*)(utils::JsonReader&, Segment&);
+            static constexpr Decoder decoders[]{ &alternative_read_json<I>... };
+            const size_t index = msg_type_index.find(reader.peek_string_field("type"));
+            if (index != msg_type_index.npos)
+                decoders[index](reader, value);
+            else
+            {
+                value = Segment(); // The same as the result of from_json, not the recycled segment
+                reader.skip();
+            }
         }
     }
 
@@ -278,7 +558,27 @@ namespace mirai
             std::make_index_sequence<std::variant_size_v<msg::Variant>>{});
     }
 
+    void read_json(utils::JsonReader& reader, Segment& value)
+    {
+        node_read_json_impl(reader, value,
+            std::make_index_sequence<std::variant_size_v<msg::Variant>>{});
+    }
+
+    void write_json(utils::JsonWriter& writer, const Segment& value)
+    {
+        value.apply([&writer](const auto& v) { write_json(writer, v); });
+    }
+
     void to_json(utils::json& json, const Message& value) { json = value.chain(); }
 
     void from_json(const utils::json& json, Message& value) { json.get_to(value.chain()); }
+
+    void read_json(utils::JsonReader& reader, Message& value) { read_json(reader, value.chain()); }
+
+    void write_json(utils::JsonWriter& writer, const Message& value)
+    {
+        writer.begin_array();
+        for (const Segment& segment : value.chain()) write_json(writer, segment);
+        writer.end_array();
+    }
 }
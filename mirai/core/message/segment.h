@@ -234,28 +234,52 @@ namespace mirai
 
         void to_json(utils::json& json, const Source& value);
         void from_json(const utils::json& json, Source& value);
+        void read_json(utils::JsonReader& reader, Source& value);
+        void write_json(utils::JsonWriter& writer, const Source& value);
         void to_json(utils::json& json, const Quote& value);
         void from_json(const utils::json& json, Quote& value);
+        void read_json(utils::JsonReader& reader, Quote& value);
+        void write_json(utils::JsonWriter& writer, const Quote& value);
         void to_json(utils::json& json, const At& value);
         void from_json(const utils::json& json, At& value);
+        void read_json(utils::JsonReader& reader, At& value);
+        void write_json(utils::JsonWriter& writer, const At& value);
         void to_json(utils::json& json, const AtAll& value);
         void from_json(const utils::json& json, AtAll& value);
+        void read_json(utils::JsonReader& reader, AtAll& value);
+        void write_json(utils::JsonWriter& writer, const AtAll& value);
         void to_json(utils::json& json, const Face& value);
         void from_json(const utils::json& json, Face& value);
+        void read_json(utils::JsonReader& reader, Face& value);
+        void write_json(utils::JsonWriter& writer, const Face& value);
         void to_json(utils::json& json, const Plain& value);
         void from_json(const utils::json& json, Plain& value);
+        void read_json(utils::JsonReader& reader, Plain& value);
+        void write_json(utils::JsonWriter& writer, const Plain& value);
         void to_json(utils::json& json, const Image& value);
         void from_json(const utils::json& json, Image& value);
+        void read_json(utils::JsonReader& reader, Image& value);
+        void write_json(utils::JsonWriter& writer, const Image& value);
         void to_json(utils::json& json, const FlashImage& value);
         void from_json(const utils::json& json, FlashImage& value);
+        void read_json(utils::JsonReader& reader, FlashImage& value);
+        void write_json(utils::JsonWriter& writer, const FlashImage& value);
         void to_json(utils::json& json, const Xml& value);
         void from_json(const utils::json& json, Xml& value);
+        void read_json(utils::JsonReader& reader, Xml& value);
+        void write_json(utils::JsonWriter& writer, const Xml& value);
         void to_json(utils::json& json, const Json& value);
         void from_json(const utils::json& json, Json& value);
+        void read_json(utils::JsonReader& reader, Json& value);
+        void write_json(utils::JsonWriter& writer, const Json& value);
         void to_json(utils::json& json, const App& value);
         void from_json(const utils::json& json, App& value);
+        void read_json(utils::JsonReader& reader, App& value);
+        void write_json(utils::JsonWriter& writer, const App& value);
         void to_json(utils::json& json, const Poke& value);
         void from_json(const utils::json& json, Poke& value);
+        void read_json(utils::JsonReader& reader, Poke& value);
+        void write_json(utils::JsonWriter& writer, const Poke& value);
 
         using Variant = std::variant<At, AtAll, Face, Plain, Image,
             FlashImage, Xml, Json, App, Poke>;
@@ -294,8 +318,12 @@ namespace mirai
 
     void to_json(utils::json& json, const Segment& value);
     void from_json(const utils::json& json, Segment& value);
+    void read_json(utils::JsonReader& reader, Segment& value);
+    void write_json(utils::JsonWriter& writer, const Segment& value);
     void to_json(utils::json& json, const Message& value);
     void from_json(const utils::json& json, Message& value);
+    void read_json(utils::JsonReader& reader, Message& value);
+    void write_json(utils::JsonWriter& writer, const Message& value);
 
     namespace detail
     {
@@ -0,0 +1,113 @@
+#include "send_queue.h"
+
+namespace mirai
+{
+    void SendQueue::push_content(const SendTarget& target, Content content)
+    {
+        std::lock_guard lock(mutex_);
+        // A target stays in the map while it has messages queued or in flight,
+        // newly inserted targets are idle so they're ready to be sent to at once
+        const auto [iter, inserted] = queues_.try_emplace(target);
+        iter->second.emplace_back(std::move(content));
+        if (inserted) ready_.push_back(target);
+        pending_++;
+        dispatch();
+    }
+
+    void SendQueue::dispatch()
+    {
+        while (in_flight_ < max_in_flight_ && !ready_.empty())
+        {
+            const SendTarget target = ready_.front();
+            ready_.pop_front();
+            auto& queue = queues_.at(target);
+            Content content = std::move(queue.front());
+            queue.pop_front();
+            in_flight_++;
+            asio::post(pool_, [this, target, content = std::move(content)]()
+            {
+                send(target, content);
+                complete(target);
+            });
+        }
+    }
+
+    void SendQueue::send(const SendTarget& target, const Content& content) const
+    {
+        try
+        {
+            if (const auto* msg = std::get_if<Message>(&content))
+            {
+                switch (target.type)
+                {
+                    case TargetType::friend_: (void)session_.send_message(target.qq, *msg); break;
+                    case TargetType::group: (void)session_.send_message(target.group, *msg); break;
+                    case TargetType::temp: (void)session_.send_message(target.qq, target.group, *msg); break;
+                }
+            }
+            else
+            {
+                const auto& urls = std::get<std::vector<std::string>>(content);
+                switch (target.type)
+                {
+                    case TargetType::friend_: (void)session_.send_image_message(target.qq, urls); break;
+                    case TargetType::group: (void)session_.send_image_message(target.group, urls); break;
+                    case TargetType::temp: (void)session_.send_image_message(target.qq, target.group, urls); break;
+                }
+            }
+        }
+        catch (...)
+        {
+            try { error_handler_(); }
+            catch (...) {}
+        }
+    }
+
+    void SendQueue::complete(const SendTarget& target)
+    {
+        std::lock_guard lock(mutex_);
+        in_flight_--;
+        pending_--;
+        const auto iter = queues_.find(target);
+        if (iter->second.empty())
+            queues_.erase(iter);
+        else
+            ready_.push_back(target); // Requeue at the back for fairness among the targets
+        dispatch();
+        if (pending_ == 0) idle_cv_.notify_all();
+    }
+
+    SendQueue::SendQueue(const Session& session, const size_t max_in_flight,
+        std::function<void()> error_handler):
+        session_(session), error_handler_(std::move(error_handler)),
+        max_in_flight_(max_in_flight != 0 ? max_in_flight : 1),
+        pool_(max_in_flight_) {}
+
+    SendQueue::~SendQueue() noexcept
+    {
+        wait();
+        pool_.join();
+    }
+
+    void SendQueue::push(const SendTarget& target, Message message)
+    {
+        push_content(target, std::move(message));
+    }
+
+    void SendQueue::push_images(const SendTarget& target, std::vector<std::string> urls)
+    {
+        push_content(target, std::move(urls));
+    }
+
+    size_t SendQueue::pending() const
+    {
+        std::lock_guard lock(mutex_);
+        return pending_;
+    }
+
+    void SendQueue::wait()
+    {
+        std::unique_lock lock(mutex_);
+        idle_cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "session.h"
+
+namespace mirai
+{
+    /**
+     * \brief Target of a message sent through a send queue
+     */
+    struct SendTarget final
+    {
+        TargetType type = TargetType::friend_; ///< Type of the target
+        uid_t qq; ///< Target QQ (friend and temp)
+        gid_t group; ///< Target group (group and temp)
+
+        /**
+         * \brief Construct a friend target
+         * \param friend_ The friend QQ
+         */
+        SendTarget(const uid_t friend_): qq(friend_) {}
+
+        /**
+         * \brief Construct a group target
+         * \param group The group ID
+         */
+        SendTarget(const gid_t group): type(TargetType::group), group(group) {}
+
+        /**
+         * \brief Construct a temporary chat target
+         * \param qq The target QQ
+         * \param group The group to start the temporary chat from
+         */
+        SendTarget(const uid_t qq, const gid_t group): type(TargetType::temp), qq(qq), group(group) {}
+
+        friend bool operator==(const SendTarget& lhs, const SendTarget& rhs)
+        {
+            return lhs.type == rhs.type
+                && lhs.qq == rhs.qq
+                && lhs.group == rhs.group;
+        }
+        friend bool operator!=(const SendTarget& lhs, const SendTarget& rhs) { return !(lhs == rhs); }
+    };
+}
+
+namespace std
+{
+    template <>
+    struct hash<mirai::SendTarget>
+    {
+        auto operator()(const mirai::SendTarget& value) const noexcept
+        {
+            const size_t qq = hash<mirai::uid_t>()(value.qq);
+            const size_t group = hash<mirai::gid_t>()(value.group);
+            return (qq * 31 + group) * 31 + size_t(value.type);
+        }
+    };
+}
+
+namespace mirai
+{
+    /**
+     * \brief An outbound message pipeline layered on a session
+     * \details Messages pushed into the queue are sent on worker threads, so
+     * pushing returns immediately. At most a configured amount of requests are
+     * in flight at the same time, and the messages to the same target are
+     * always sent one after another in the order they were pushed.
+     * \remarks The session must outlive the queue. The destructor waits for all
+     * the queued messages to be sent.
+     */
+    class SendQueue final
+    {
+    private:
+        using Content = std::variant<Message, std::vector<std::string>>;
+
+        const Session& session_;
+        std::function<void()> error_handler_;
+        size_t max_in_flight_ = 0;
+        size_t in_flight_ = 0;
+        size_t pending_ = 0;
+        mutable std::mutex mutex_;
+        std::condition_variable idle_cv_;
+        std::unordered_map<SendTarget, std::deque<Content>> queues_;
+        std::deque<SendTarget> ready_;
+        asio::thread_pool pool_;
+
+        void push_content(const SendTarget& target, Content content);
+        void dispatch(); // Must be called with the mutex locked
+        void send(const SendTarget& target, const Content& content) const;
+        void complete(const SendTarget& target);
+    public:
+        /**
+         * \brief Construct a send queue
+         * \param session The session used for sending the messages
+         * \param max_in_flight Maximum amount of requests in flight at the same time
+         * \param error_handler The error handler, called in a catch block when
+         * sending a message fails
+         */
+        explicit SendQueue(const Session& session, size_t max_in_flight = 4,
+            std::function<void()> error_handler = error_logger);
+
+        /**
+         * \brief Wait for all the queued messages to be sent and destroy the queue
+         */
+        ~SendQueue() noexcept;
+
+        /**
+         * \brief Send queues cannot be copied
+         */
+        SendQueue(const SendQueue&) = delete;
+
+        /**
+         * \brief Send queues cannot be moved
+         */
+        SendQueue(SendQueue&&) = delete;
+
+        /**
+         * \brief Send queues cannot be copied
+         */
+        SendQueue& operator=(const SendQueue&) = delete;
+
+        /**
+         * \brief Send queues cannot be moved
+         */
+        SendQueue& operator=(SendQueue&&) = delete;
+
+        /**
+         * \brief Queue a message to be sent
+         * \param target Target of the message
+         * \param message The message
+         */
+        void push(const SendTarget& target, Message message);
+
+        /**
+         * \brief Queue images to be sent via URLs
+         * \param target Target of the images
+         * \param urls Image URLs
+         */
+        void push_images(const SendTarget& target, std::vector<std::string> urls);
+
+        /**
+         * \brief Get the amount of messages queued or being sent
+         * \return The amount
+         */
+        size_t pending() const;
+
+        /**
+         * \brief Block until all the queued messages are sent
+         */
+        void wait();
+    };
+}
@@ -1,53 +1,238 @@
 #include "session.h"
-#include <cpr/cpr.h>
 #include "common.h"
 
 namespace mirai
 {
+    namespace
+    {
+        // Read a response object with an error code and a message, throw if
+        // the code is not 0 (success), other fields are read by the callback
+        template <typename F>
+        void read_response_object(utils::JsonReader& reader, F&& on_field)
+        {
+            int32_t code = 0;
+            std::string message;
+            reader.read_object([&](const std::string_view key)
+            {
+                if (key == "code") read_json(reader, code);
+                else if (key == "msg") read_json(reader, message);
+                else on_field(key);
+            });
+            reader.expect_end();
+            if (code != 0) throw RuntimeError(message);
+        }
+
+        template <typename T>
+        T read_data_response(const std::string_view text)
+        {
+            utils::JsonReader reader(text);
+            T data{};
+            read_response_object(reader, [&](const std::string_view key)
+            {
+                if (key == "data") read_json(reader, data);
+                else reader.skip();
+            });
+            return data;
+        }
+
+        // Lists are responded as bare arrays, errors are objects with a code and a message
+        template <typename T>
+        std::vector<T> read_list_response(const std::string_view text)
+        {
+            utils::JsonReader reader(text);
+            if (reader.peek() == utils::JsonReader::Kind::object)
+            {
+                read_response_object(reader, [&](std::string_view) { reader.skip(); });
+                throw RuntimeError("Unexpected response object");
+            }
+            std::vector<T> list;
+            read_json(reader, list);
+            reader.expect_end();
+            return list;
+        }
+
+        void read_status_response(const std::string_view text)
+        {
+            utils::JsonReader reader(text);
+            read_response_object(reader, [&](std::string_view) { reader.skip(); });
+        }
+
+        msgid_t read_message_id_response(const std::string_view text)
+        {
+            utils::JsonReader reader(text);
+            std::optional<msgid_t> id;
+            read_response_object(reader, [&](const std::string_view key)
+            {
+                if (key == "messageId") read_json(reader, id.emplace());
+                else reader.skip();
+            });
+            if (!id) throw RuntimeError("Missing message ID in the response");
+            return *id;
+        }
+
+        void write_quote(utils::JsonWriter& writer, const utils::OptionalParam<msgid_t> quote)
+        {
+            if (quote) writer.write_field("quote", *quote);
+        }
+    }
+
+    template <typename F>
+    auto Session::post_request(F&& func) const
+    {
+        using Result = std::invoke_result_t<std::decay_t<F>&>;
+        if (!request_pool_) throw RuntimeError("Invalid session");
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        std::future<Result> future = task->get_future();
+        request_pool_->post([task]() { (*task)(); });
+        return future;
+    }
+
+    bool Session::accept_frame(const EventTypeSet types, ws::Connection& connection,
+        const std::string_view payload)
+    {
+        if (types == EventTypeSet::all()) return true;
+        utils::JsonReader reader(payload);
+        const size_t index = event_type_index.find(reader.peek_string_field("type"));
+        // Frames that are not known events are passed on for the errors to be reported
+        if (index == event_type_index.npos || types.contains(EventType(index))) return true;
+        connection.count_filtered_frame();
+        return false;
+    }
+
+    void Session::backfill_events(Transport& transport, const std::string& session_key,
+        ws::Connection& connection, const std::string_view url, detail::RecentFrames& recent)
+    {
+        // Only pass on the events the channel of the connection would deliver
+        const EventTypeSet channel =
+            url == "/message" ? EventTypeSet::messages() :
+            url == "/event" ? EventTypeSet::all()
+                .erase(EventType::group_message)
+                .erase(EventType::friend_message)
+                .erase(EventType::temp_message) :
+            EventTypeSet::all();
+        // Peeking leaves the events to the other subscriptions of the session
+        const std::string response = transport.get("/peekLatestMessage", {
+            { "sessionKey", session_key },
+            { "count", std::to_string(recent.capacity()) }
+        });
+        using Message = ws::AsioClient::message_ptr::element_type;
+        std::vector<ws::AsioClient::message_ptr> frames;
+        utils::JsonReader reader(response);
+        read_response_object(reader, [&](const std::string_view key)
+        {
+            if (key != "data")
+            {
+                reader.skip();
+                return;
+            }
+            reader.read_array([&]
+            {
+                const size_t index = event_type_index.find(reader.peek_string_field("type"));
+                if (index != event_type_index.npos && !channel.contains(EventType(index)))
+                {
+                    reader.skip();
+                    return;
+                }
+                const std::string_view payload = reader.read_raw();
+                if (recent.contains(payload)) return; // Received before the connection dropped
+                const auto frame = std::make_shared<Message>(nullptr, websocketpp::frame::opcode::text, 0);
+                frame->get_raw_payload() = payload;
+                frames.push_back(frame);
+            });
+        });
+        // The latest events are listed newest first
+        for (auto iter = frames.rbegin(); iter != frames.rend(); ++iter)
+            connection.on_message(connection.handle(), *iter);
+    }
+
+    EventStorage& Session::event_storage()
+    {
+        // Every thread dispatching events, the WebSocket thread or a thread in the
+        // pool, decodes into its own storage
+        thread_local EventStorage storage;
+        return storage;
+    }
+
+    utils::json Session::get_json(const std::string_view url,
+        const utils::ArrayProxy<utils::QueryParameter> parameters) const
+    {
+        return utils::json::parse(transport_->get(url, parameters));
+    }
+
+    utils::json Session::post_json(const std::string_view url,
+        const utils::json& json, const bool idempotent) const
+    {
+        return utils::json::parse(transport_->post_json(url, json.dump(), idempotent));
+    }
+
+    template <typename F>
+    std::string Session::post_fields(const std::string_view url, F&& write_fields, const bool idempotent) const
+    {
+        // Bodies are written into a per-thread buffer to keep its capacity across requests,
+        // the buffer is taken out while in use in case a transport sends requests reentrantly
+        thread_local std::string cached_buffer;
+        std::string buffer = std::move(cached_buffer);
+        buffer.clear();
+        utils::JsonWriter writer(buffer);
+        writer.continue_object(body_prefix_);
+        write_fields(writer);
+        writer.end_object();
+        std::string response = transport_->post_json(url, buffer, idempotent);
+        cached_buffer = std::move(buffer);
+        return response;
+    }
+
     std::vector<std::string> Session::send_image_message(
         const utils::OptionalParam<uid_t> qq,
         const utils::OptionalParam<gid_t> group,
         const utils::ArrayProxy<std::string> urls) const
     {
-        utils::json json{
-            { "sessionKey", key_ },
-            { "urls", std::vector(urls.begin(), urls.end()) }
-        };
-        if (qq) json["qq"] = *qq;
-        if (group) json["group"] = *group;
-        const auto res = utils::post_json("/sendImageMessage", json);
-        return res.get<std::vector<std::string>>();
+        return read_list_response<std::string>(post_fields("/sendImageMessage", [&](utils::JsonWriter& writer)
+        {
+            if (qq) writer.write_field("qq", *qq);
+            if (group) writer.write_field("group", *group);
+            writer.write_key("urls");
+            writer.begin_array();
+            for (const std::string& url : urls) writer.write_string(url);
+            writer.end_array();
+        }));
     }
 
     std::vector<Event> Session::get_events(const std::string_view url, const size_t count) const
     {
-        const utils::json res = utils::get(url, {
+        return read_data_response<std::vector<Event>>(transport_->get(url, {
             { "sessionKey", key_ },
             { "count", std::to_string(count) }
-        });
-        utils::check_response(res);
-        return res.at("data").get<std::vector<Event>>();
+        }));
     }
 
-    Session::Session(const std::string_view auth_key, const uid_t qq)
+    Session::Session(const std::string_view auth_key, const uid_t qq, const SessionSettings& settings):
+        transport_(settings.transport ? settings.transport : std::make_shared<NetworkTransport>(
+            settings.host, settings.max_connections, settings.retry, settings.circuit_breaker, settings.timeout,
+            ws::ClientOptions{ settings.websocket_threads, settings.reconnect,
+                settings.ping_interval, settings.websocket_compression }, settings.websocket_client)),
+        recycle_events_(settings.recycle_events), backfill_events_(settings.backfill_events),
+        event_queue_(settings.event_queue), shared_pool_(settings.executor)
     {
         // Authorize
         {
-            const auto res = utils::post_json("/auth", {
+            const auto res = post_json("/auth", {
                 { "authKey", std::string(auth_key) }
             });
             utils::check_response(res);
             res.at("session").get_to(key_);
+            utils::JsonWriter writer(body_prefix_);
+            writer.begin_object();
+            writer.write_field("sessionKey", key_);
         }
         // Verify
+        read_status_response(post_fields("/verify", [&](utils::JsonWriter& writer)
         {
-            const auto res = utils::post_json("/verify", {
-                { "sessionKey", key_ },
-                { "qq", qq }
-            });
-            utils::check_response(res);
-            qq_ = qq; // QQ ID set (not 0) means the initialization has completed
-        }
+            writer.write_field("qq", qq);
+        }));
+        // Never the shared pool, event handlers waiting on asynchronous requests would starve them
+        request_pool_ = std::make_unique<utils::Executor>(transport_->concurrency());
+        qq_ = qq; // QQ ID set (not 0) means the initialization has completed
     }
 
     Session::~Session() noexcept
@@ -57,19 +242,21 @@ namespace mirai
         {
             close_websocket_client();
             destroy_thread_pool();
-            utils::post_json("/release", {
-                { "sessionKey", key_ },
-                { "qq", qq_ }
+            request_pool_->join();
+            post_fields("/release", [&](utils::JsonWriter& writer)
+            {
+                writer.write_field("qq", qq_);
             });
         }
         catch (...) { std::abort(); }
     }
 
-    Session::Session(Session&& other) noexcept :
-        qq_(std::exchange(other.qq_, {})),
-        key_(std::move(other.key_)),
-        client_(std::move(other.client_)),
-        thread_pool_(std::move(other.thread_pool_)) {}
+    Session::Session(Session&& other) noexcept
+    {
+        // The pending asynchronous requests of the other session refer to it
+        if (other.request_pool_) other.request_pool_->wait();
+        swap(other);
+    }
 
     Session& Session::operator=(Session&& other) noexcept
     {
@@ -82,23 +269,41 @@ namespace mirai
     {
         std::swap(qq_, other.qq_);
         std::swap(key_, other.key_);
-        std::swap(client_, other.client_);
+        std::swap(body_prefix_, other.body_prefix_);
+        std::swap(transport_, other.transport_);
+        std::swap(recycle_events_, other.recycle_events_);
+        std::swap(backfill_events_, other.backfill_events_);
+        std::swap(event_queue_, other.event_queue_);
+        std::swap(event_queues_, other.event_queues_);
+        std::swap(shared_pool_, other.shared_pool_);
         std::swap(thread_pool_, other.thread_pool_);
+        std::swap(request_pool_, other.request_pool_);
     }
 
     void Session::start_thread_pool(const utils::OptionalParam<size_t> thread_count)
     {
         if (!thread_pool_)
         {
-            if (thread_count)
-                thread_pool_ = std::make_unique<asio::thread_pool>(*thread_count);
+            if (shared_pool_)
+            {
+                if (thread_count) throw RuntimeError("The thread count of a shared thread pool cannot be set");
+                thread_pool_ = std::make_unique<utils::Executor>(shared_pool_);
+            }
             else
-                thread_pool_ = std::make_unique<asio::thread_pool>();
+                thread_pool_ = std::make_unique<utils::Executor>(thread_count ? *thread_count : 0);
         }
     }
 
+    void Session::close_event_queues()
+    {
+        for (const auto& weak : event_queues_)
+            if (const auto queue = weak.lock()) queue->close();
+        event_queues_.clear();
+    }
+
     void Session::destroy_thread_pool()
     {
+        close_event_queues();
         if (thread_pool_)
             thread_pool_->join();
         thread_pool_.reset();
@@ -107,44 +312,105 @@ namespace mirai
     msgid_t Session::send_message(const uid_t friend_,
         const Message& msg, const utils::OptionalParam<msgid_t> quote) const
     {
-        utils::json json{
-            { "sessionKey", key_ },
-            { "target", friend_ },
-            { "messageChain", msg }
-        };
-        if (quote.has_value()) json["quote"] = *quote;
-        const auto res = utils::post_json("/sendFriendMessage", json);
-        utils::check_response(res);
-        return res.at("messageId").get<msgid_t>();
+        return read_message_id_response(post_fields("/sendFriendMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", friend_);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const uid_t friend_,
+        Message msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, friend_, quote, msg = std::move(msg)]() { return send_message(friend_, msg, quote); });
     }
 
     msgid_t Session::send_message(const uid_t qq, const gid_t group,
         const Message& msg, const utils::OptionalParam<msgid_t> quote) const
     {
-        utils::json json{
-            { "sessionKey", key_ },
-            { "qq", qq },
-            { "group", group },
-            { "messageChain", msg }
-        };
-        if (quote.has_value()) json["quote"] = *quote;
-        const auto res = utils::post_json("/sendTempMessage", json);
-        utils::check_response(res);
-        return res.at("messageId").get<msgid_t>();
+        return read_message_id_response(post_fields("/sendTempMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("qq", qq);
+            writer.write_field("group", group);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const uid_t qq, const gid_t group,
+        Message msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, qq, group, quote, msg = std::move(msg)]() { return send_message(qq, group, msg, quote); });
     }
 
     msgid_t Session::send_message(const gid_t target,
         const Message& msg, const utils::OptionalParam<msgid_t> quote) const
     {
-        utils::json json{
-            { "sessionKey", key_ },
-            { "target", target },
-            { "messageChain", msg }
-        };
-        if (quote.has_value()) json["quote"] = *quote;
-        const auto res = utils::post_json("/sendGroupMessage", json);
-        utils::check_response(res);
-        return res.at("messageId").get<msgid_t>();
+        return read_message_id_response(post_fields("/sendGroupMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", target);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const gid_t target,
+        Message msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, target, quote, msg = std::move(msg)]() { return send_message(target, msg, quote); });
+    }
+
+    msgid_t Session::send_message(const uid_t friend_,
+        const PreparedMessage& msg, const utils::OptionalParam<msgid_t> quote) const
+    {
+        return read_message_id_response(post_fields("/sendFriendMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", friend_);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const uid_t friend_,
+        PreparedMessage msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, friend_, quote, msg = std::move(msg)]() { return send_message(friend_, msg, quote); });
+    }
+
+    msgid_t Session::send_message(const uid_t qq, const gid_t group,
+        const PreparedMessage& msg, const utils::OptionalParam<msgid_t> quote) const
+    {
+        return read_message_id_response(post_fields("/sendTempMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("qq", qq);
+            writer.write_field("group", group);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const uid_t qq, const gid_t group,
+        PreparedMessage msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, qq, group, quote, msg = std::move(msg)]() { return send_message(qq, group, msg, quote); });
+    }
+
+    msgid_t Session::send_message(const gid_t target,
+        const PreparedMessage& msg, const utils::OptionalParam<msgid_t> quote) const
+    {
+        return read_message_id_response(post_fields("/sendGroupMessage", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", target);
+            write_quote(writer, quote);
+            writer.write_field("messageChain", msg);
+        }));
+    }
+
+    std::future<msgid_t> Session::send_message_async(const gid_t target,
+        PreparedMessage msg, const std::optional<msgid_t> quote) const
+    {
+        return post_request([this, target, quote, msg = std::move(msg)]() { return send_message(target, msg, quote); });
     }
 
     msgid_t Session::send_quote_message(const FriendMessage& quote, const Message& msg) const
@@ -152,57 +418,95 @@ namespace mirai
         return send_message(quote.sender.id, msg, quote.message.source.id);
     }
 
+    std::future<msgid_t> Session::send_quote_message_async(const FriendMessage& quote, Message msg) const
+    {
+        return send_message_async(quote.sender.id, std::move(msg), quote.message.source.id);
+    }
+
     msgid_t Session::send_quote_message(const TempMessage& quote, const Message& msg) const
     {
         return send_message(quote.sender.id, quote.sender.group.id, msg, quote.message.source.id);
     }
 
+    std::future<msgid_t> Session::send_quote_message_async(const TempMessage& quote, Message msg) const
+    {
+        return send_message_async(quote.sender.id, quote.sender.group.id,
+            std::move(msg), quote.message.source.id);
+    }
+
     msgid_t Session::send_quote_message(const GroupMessage& quote, const Message& msg) const
     {
         return send_message(quote.sender.group.id, msg, quote.message.source.id);
     }
 
+    std::future<msgid_t> Session::send_quote_message_async(const GroupMessage& quote, Message msg) const
+    {
+        return send_message_async(quote.sender.group.id, std::move(msg), quote.message.source.id);
+    }
+
     std::vector<std::string> Session::send_image_message(
         const uid_t friend_, const utils::ArrayProxy<std::string> urls) const
     {
         return send_image_message(friend_, {}, urls);
     }
 
+    std::future<std::vector<std::string>> Session::send_image_message_async(
+        const uid_t friend_, std::vector<std::string> urls) const
+    {
+        return post_request([this, friend_, urls = std::move(urls)]() { return send_image_message(friend_, urls); });
+    }
+
     std::vector<std::string> Session::send_image_message(
         const gid_t group, const utils::ArrayProxy<std::string> urls) const
     {
         return send_image_message({}, group, urls);
     }
 
+    std::future<std::vector<std::string>> Session::send_image_message_async(
+        const gid_t group, std::vector<std::string> urls) const
+    {
+        return post_request([this, group, urls = std::move(urls)]() { return send_image_message(group, urls); });
+    }
+
     std::vector<std::string> Session::send_image_message(const uid_t qq, const gid_t group,
         const utils::ArrayProxy<std::string> urls) const
     {
         return send_image_message(utils::OptionalParam(qq), group, urls);
     }
 
+    std::future<std::vector<std::string>> Session::send_image_message_async(
+        const uid_t qq, const gid_t group, std::vector<std::string> urls) const
+    {
+        return post_request([this, qq, group, urls = std::move(urls)]() { return send_image_message(qq, group, urls); });
+    }
+
     msg::Image Session::upload_image(const TargetType type, const std::string& path) const
     {
         static constexpr std::array type_names{ "friend", "group", "temp" };
-        const cpr::Response response = Post(
-            cpr::Url{ std::string(base_url) += "/uploadImage" },
-            cpr::Multipart{
-                { "sessionKey", key_ },
-                { "type", type_names[size_t(type)] },
-                { "img", cpr::File(path) }
-            });
-        if (response.status_code != 200) // Status code not OK
-            throw RuntimeError(response.error.message);
-        return utils::json::parse(response.text).get<msg::Image>();
+        const std::string res = transport_->post_multipart("/uploadImage", {
+            { "sessionKey", key_ },
+            { "type", type_names[size_t(type)] },
+            { "img", path, true }
+        });
+        return utils::read_json_text<msg::Image>(res);
+    }
+
+    std::future<msg::Image> Session::upload_image_async(const TargetType type, std::string path) const
+    {
+        return post_request([this, type, path = std::move(path)]() { return upload_image(type, path); });
     }
 
     void Session::recall(const msgid_t message_id) const
     {
-        const utils::json json{
-            { "sessionKey", key_ },
-            { "target", message_id }
-        };
-        const auto res = utils::post_json("/recall", json);
-        utils::check_response(res);
+        read_status_response(post_fields("/recall", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", message_id);
+        }));
+    }
+
+    std::future<void> Session::recall_async(const msgid_t message_id) const
+    {
+        return post_request([this, message_id]() { recall(message_id); });
     }
 
     std::vector<Event> Session::fetch_events(const size_t count) const
@@ -210,189 +514,291 @@ namespace mirai
         return get_events("/fetchMessage", count);
     }
 
+    std::future<std::vector<Event>> Session::fetch_events_async(const size_t count) const
+    {
+        return post_request([this, count]() { return fetch_events(count); });
+    }
+
     std::vector<Event> Session::fetch_latest_events(const size_t count) const
     {
         return get_events("/fetchLatestMessage", count);
     }
 
+    std::future<std::vector<Event>> Session::fetch_latest_events_async(const size_t count) const
+    {
+        return post_request([this, count]() { return fetch_latest_events(count); });
+    }
+
     std::vector<Event> Session::peek_events(const size_t count) const
     {
         return get_events("/peekMessage", count);
     }
 
+    std::future<std::vector<Event>> Session::peek_events_async(const size_t count) const
+    {
+        return post_request([this, count]() { return peek_events(count); });
+    }
+
     std::vector<Event> Session::peek_latest_events(const size_t count) const
     {
         return get_events("/peekLatestMessage", count);
     }
 
+    std::future<std::vector<Event>> Session::peek_latest_events_async(const size_t count) const
+    {
+        return post_request([this, count]() { return peek_latest_events(count); });
+    }
+
     size_t Session::count_events() const
     {
-        const utils::json res = utils::get("/countMessage",
-            { { "sessionKey", key_ } });
-        utils::check_response(res);
-        return res.at("data").get<size_t>();
+        return read_data_response<size_t>(transport_->get("/countMessage",
+            { { "sessionKey", key_ } }));
+    }
+
+    std::future<size_t> Session::count_events_async() const
+    {
+        return post_request([this]() { return count_events(); });
     }
 
     Event Session::message_from_id(const msgid_t id) const
     {
-        const utils::json res = utils::get("/messageFromId", {
+        return read_data_response<Event>(transport_->get("/messageFromId", {
             { "sessionKey", key_ },
             { "id", std::to_string(id) }
-        });
-        utils::check_response(res);
-        return res.at("data").get<Event>();
+        }));
+    }
+
+    std::future<Event> Session::message_from_id_async(const msgid_t id) const
+    {
+        return post_request([this, id]() { return message_from_id(id); });
     }
 
     std::vector<Friend> Session::friend_list() const
     {
-        const utils::json res = utils::get("/friendList",
-            { { "sessionKey", key_ } });
-        return res.get<std::vector<Friend>>();
+        return read_list_response<Friend>(transport_->get("/friendList",
+            { { "sessionKey", key_ } }));
+    }
+
+    std::future<std::vector<Friend>> Session::friend_list_async() const
+    {
+        return post_request([this]() { return friend_list(); });
     }
 
     std::vector<Group> Session::group_list() const
     {
-        const utils::json res = utils::get("/groupList",
-            { { "sessionKey", key_ } });
-        return res.get<std::vector<Group>>();
+        return read_list_response<Group>(transport_->get("/groupList",
+            { { "sessionKey", key_ } }));
+    }
+
+    std::future<std::vector<Group>> Session::group_list_async() const
+    {
+        return post_request([this]() { return group_list(); });
     }
 
     std::vector<Member> Session::member_list(const gid_t target) const
     {
-        const utils::json res = utils::get("/memberList", {
+        return read_list_response<Member>(transport_->get("/memberList", {
             { "sessionKey", key_ },
             { "target", std::to_string(target) }
-        });
-        utils::check_response(res);
-        return res.get<std::vector<Member>>();
+        }));
+    }
+
+    std::future<std::vector<Member>> Session::member_list_async(const gid_t target) const
+    {
+        return post_request([this, target]() { return member_list(target); });
     }
 
     void Session::mute_all(const gid_t target) const
     {
-        const utils::json res = utils::post_json("/muteAll", {
-            { "sessionKey", key_ },
-            { "target", target }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/muteAll", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", target);
+        }, true));
+    }
+
+    std::future<void> Session::mute_all_async(const gid_t target) const
+    {
+        return post_request([this, target]() { mute_all(target); });
     }
 
     void Session::unmute_all(const gid_t target) const
     {
-        const utils::json res = utils::post_json("/unmuteAll", {
-            { "sessionKey", key_ },
-            { "target", target }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/unmuteAll", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", target);
+        }, true));
+    }
+
+    std::future<void> Session::unmute_all_async(const gid_t target) const
+    {
+        return post_request([this, target]() { unmute_all(target); });
     }
 
     void Session::mute(const gid_t group, const uid_t member,
         const std::chrono::seconds duration) const
     {
-        const utils::json res = utils::post_json("/mute", {
-            { "sessionKey", key_ },
-            { "target", group },
-            { "memberId", member },
-            { "time", duration.count() }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/mute", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", group);
+            writer.write_field("memberId", member);
+            writer.write_field("time", duration.count());
+        }, true));
+    }
+
+    std::future<void> Session::mute_async(const gid_t group, const uid_t member,
+        const std::chrono::seconds duration) const
+    {
+        return post_request([this, group, member, duration]() { mute(group, member, duration); });
     }
 
     void Session::unmute(const gid_t group, const uid_t member) const
     {
-        const utils::json res = utils::post_json("/unmute", {
-            { "sessionKey", key_ },
-            { "target", group },
-            { "memberId", member }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/unmute", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", group);
+            writer.write_field("memberId", member);
+        }, true));
+    }
+
+    std::future<void> Session::unmute_async(const gid_t group, const uid_t member) const
+    {
+        return post_request([this, group, member]() { unmute(group, member); });
     }
 
     void Session::kick(const gid_t group, const uid_t member,
         const std::string_view message) const
     {
-        const utils::json res = utils::post_json("/kick", {
-            { "sessionKey", key_ },
-            { "target", group },
-            { "memberId", member },
-            { "msg", message }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/kick", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", group);
+            writer.write_field("memberId", member);
+            writer.write_field("msg", message);
+        }));
+    }
+
+    std::future<void> Session::kick_async(const gid_t group, const uid_t member,
+        std::string message) const
+    {
+        return post_request([this, group, member, message = std::move(message)]() { kick(group, member, message); });
     }
 
     void Session::quit(const gid_t group) const
     {
-        const utils::json res = utils::post_json("/quit", {
-            { "sessionKey", key_ },
-            { "target", group }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/quit", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", group);
+        }));
+    }
+
+    std::future<void> Session::quit_async(const gid_t group) const
+    {
+        return post_request([this, group]() { quit(group); });
     }
 
     void Session::respond_new_friend_request(const NewFriendRequestEvent& event,
         const NewFriendResponseType type, const std::string_view message) const
     {
-        const utils::json res = utils::post_json("/resp/newFriendRequestEvent", {
-            { "sessionKey", key_ },
-            { "eventId", event.event_id },
-            { "fromId", event.from_id },
-            { "groupId", event.group_id.value_or(gid_t{}) },
-            { "operate", int32_t(type) },
-            { "message", message }
+        read_status_response(post_fields("/resp/newFriendRequestEvent", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("eventId", event.event_id);
+            writer.write_field("fromId", event.from_id);
+            writer.write_field("groupId", event.group_id.value_or(gid_t{}));
+            writer.write_field("operate", int32_t(type));
+            writer.write_field("message", message);
+        }));
+    }
+
+    std::future<void> Session::respond_new_friend_request_async(NewFriendRequestEvent event,
+        const NewFriendResponseType type, std::string message) const
+    {
+        return post_request([this, type, event = std::move(event), message = std::move(message)]()
+        {
+            respond_new_friend_request(event, type, message);
         });
-        utils::check_response(res);
     }
 
     void Session::respond_member_join_request(const MemberJoinRequestEvent& event,
         const MemberJoinResponseType type, const std::string_view message) const
     {
-        const utils::json res = utils::post_json("/resp/memberJoinRequestEvent", {
-            { "sessionKey", key_ },
-            { "eventId", event.event_id },
-            { "fromId", event.from_id },
-            { "groupId", event.group_id },
-            { "operate", int32_t(type) },
-            { "message", message }
+        read_status_response(post_fields("/resp/memberJoinRequestEvent", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("eventId", event.event_id);
+            writer.write_field("fromId", event.from_id);
+            writer.write_field("groupId", event.group_id);
+            writer.write_field("operate", int32_t(type));
+            writer.write_field("message", message);
+        }));
+    }
+
+    std::future<void> Session::respond_member_join_request_async(MemberJoinRequestEvent event,
+        const MemberJoinResponseType type, std::string message) const
+    {
+        return post_request([this, type, event = std::move(event), message = std::move(message)]()
+        {
+            respond_member_join_request(event, type, message);
         });
-        utils::check_response(res);
     }
 
     void Session::group_config(const gid_t target, const GroupConfig& config) const
     {
-        const utils::json res = utils::post_json("/groupConfig", {
-            { "sessionKey", key_ },
-            { "target", target },
-            { "config", config }
-        });
-        utils::check_response(res);
+        read_status_response(post_fields("/groupConfig", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", target);
+            writer.write_field("config", config);
+        }, true));
+    }
+
+    std::future<void> Session::group_config_async(const gid_t target, GroupConfig config) const
+    {
+        return post_request([this, target, config = std::move(config)]() { group_config(target, config); });
     }
 
     GroupConfig Session::group_config(const gid_t target) const
     {
-        const utils::json res = utils::get("/groupConfig", {
+        const utils::json res = get_json("/groupConfig", {
             { "sessionKey", key_ },
             { "target", std::to_string(target) }
         });
         return res.get<GroupConfig>();
     }
 
+    std::future<GroupConfig> Session::group_config_async(const gid_t target) const
+    {
+        return post_request([this, target]() { return group_config(target); });
+    }
+
     void Session::member_info(const gid_t group, const uid_t member,
         const utils::OptionalParam<std::string_view> name,
         const utils::OptionalParam<std::string_view> special_title) const
     {
-        utils::json res = utils::post_json("/memberInfo", {
-            { "sessionKey", key_ },
-            { "target", group },
-            { "memberId", member },
-            { "info", {} }
+        read_status_response(post_fields("/memberInfo", [&](utils::JsonWriter& writer)
+        {
+            writer.write_field("target", group);
+            writer.write_field("memberId", member);
+            writer.write_key("info");
+            writer.begin_object();
+            if (name) writer.write_field("name", *name);
+            if (special_title) writer.write_field("specialTitle", *special_title);
+            writer.end_object();
+        }, true));
+    }
+
+    std::future<void> Session::member_info_async(const gid_t group, const uid_t member,
+        std::optional<std::string> name, std::optional<std::string> special_title) const
+    {
+        return post_request([this, group, member, name = std::move(name), special_title = std::move(special_title)]()
+        {
+            const auto to_view = [](const std::optional<std::string>& str)
+            {
+                return str ? std::optional<std::string_view>(*str) : std::nullopt;
+            };
+            member_info(group, member, to_view(name), to_view(special_title));
         });
-        if (name) res["info"]["name"] = *name;
-        if (special_title) res["info"]["specialTitle"] = *special_title;
-        utils::check_response(res);
     }
 
     MemberInfo Session::member_info(const gid_t group, const uid_t member) const
     {
-        const utils::json res = utils::get("/memberInfo", {
+        const utils::json res = get_json("/memberInfo", {
             { "sessionKey", key_ },
             { "target", std::to_string(group) },
             { "memberId", std::to_string(member) },
@@ -400,20 +806,50 @@ namespace mirai
         return res.get<MemberInfo>();
     }
 
-    void Session::close_connection(ws::Connection& connection) { client_->close(connection); }
+    std::future<MemberInfo> Session::member_info_async(const gid_t group, const uid_t member) const
+    {
+        return post_request([this, group, member]() { return member_info(group, member); });
+    }
+
+    utils::RequestStats Session::request_stats() const
+    {
+        if (!transport_) throw RuntimeError("Invalid session");
+        return transport_->request_stats();
+    }
+
+    void Session::close_websocket_client()
+    {
+        // Blocked pushes would keep the I/O threads from closing the connections
+        close_event_queues();
+        if (transport_) transport_->close_websocket();
+    }
+
+    void Session::close_connection(ws::Connection& connection) { transport_->close(connection); }
 
     void Session::config(const utils::OptionalParam<size_t> cache_size,
         const utils::OptionalParam<bool> enable_websocket) const
     {
-        utils::json json{ { "sessionKey", key_ } };
-        if (cache_size) json["cacheSize"] = *cache_size;
-        if (enable_websocket) json["enableWebsocket"] = *enable_websocket;
-        (void)utils::post_json_no_parse("/config", json);
+        (void)post_fields("/config", [&](utils::JsonWriter& writer)
+        {
+            if (cache_size) writer.write_field("cacheSize", *cache_size);
+            if (enable_websocket) writer.write_field("enableWebsocket", *enable_websocket);
+        }, true);
+    }
+
+    std::future<void> Session::config_async(const std::optional<size_t> cache_size,
+        const std::optional<bool> enable_websocket) const
+    {
+        return post_request([this, cache_size, enable_websocket]() { config(cache_size, enable_websocket); });
     }
 
     SessionConfig Session::config() const
     {
-        return utils::get("/config", { { "sessionKey", key_ } })
+        return get_json("/config", { { "sessionKey", key_ } })
            .get<SessionConfig>();
     }
+
+    std::future<SessionConfig> Session::config_async() const
+    {
+        return post_request([this]() { return config(); });
+    }
 }
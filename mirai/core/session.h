@@ -1,31 +1,111 @@
 #pragma once
 
 #include <string>
+#include <future>
+#include <deque>
+#include <mutex>
+#include <algorithm>
 #include "types.h"
 #include "events.h"
 #include "common.h"
+#include "settings.h"
 #include "message/segment.h"
-#include "websockets/client.h"
+#include "message/prepared_message.h"
+#include "transport.h"
+#include "lazy_event.h"
 #include "../utils/optional_param.h"
+#include "../utils/executor.h"
 #include "../utils/array_proxy.h"
-#include "../utils/request.h"
 #include "../utils/string.h"
 
 namespace mirai
 {
+    namespace detail
+    {
+        // Event callbacks take either an Event& or a LazyEvent&, which opts in to lazy decoding
+        template <typename F>
+        using event_callback_t = std::enable_if_t<
+            std::is_invocable_v<F, Event&> || std::is_invocable_v<F, LazyEvent&>>;
+
+        // Hashes of the payloads of the latest frames received by a connection, so that
+        // backfilling after reconnecting skips the events already handled
+        class RecentFrames final
+        {
+        private:
+            std::mutex mutex_;
+            std::deque<size_t> hashes_;
+            size_t capacity_;
+        public:
+            explicit RecentFrames(const size_t capacity): capacity_(capacity) {}
+
+            size_t capacity() const noexcept { return capacity_; }
+
+            void insert(const std::string_view payload)
+            {
+                const size_t hash = std::hash<std::string_view>{}(payload);
+                std::lock_guard lock(mutex_);
+                if (hashes_.size() == capacity_) hashes_.pop_front();
+                hashes_.push_back(hash);
+            }
+
+            bool contains(const std::string_view payload)
+            {
+                const size_t hash = std::hash<std::string_view>{}(payload);
+                std::lock_guard lock(mutex_);
+                return std::find(hashes_.begin(), hashes_.end(), hash) != hashes_.end();
+            }
+        };
+    }
+
     /**
      * \brief Type representing a session in the HTTP API
      * \details The session is released automatically in the destructor, thus
      * you don't need to manually free the resources. Session objects cannot be
-     * copied, but can be moved to transfer ownership.
+     * copied, but can be moved to transfer ownership. <br>
+     * Every HTTP API function has an asynchronous counterpart suffixed with
+     * "_async", which runs the request on a thread pool dedicated to HTTP
+     * requests and returns a std::future of the result. Exceptions thrown by
+     * the request are rethrown when calling get() on the future. Moving the
+     * session and the destructor wait for all of them to complete. <br>
+     * All the requests and WebSocket connections go through a Transport, which
+     * is a NetworkTransport unless another one is given in the settings. <br>
+     * If reconnection is enabled in the settings, dropped WebSocket connections
+     * are reestablished with the same callbacks. Events missed in the meantime
+     * can be backfilled through peek_latest_events, they are then handled just
+     * like the received ones before any event of the new connection. Peeking
+     * leaves the events queued for the other subscriptions and fetch_events, and
+     * the events matching one of the latest frames received by the connection
+     * are skipped, as the server also queues the events sent through WebSocket. <br>
+     * Sessions of many accounts can share a WebSocket client and a thread pool
+     * for the events given in the settings, so that the amount of threads does
+     * not grow with the amount of sessions. The thread pool for the HTTP requests
+     * stays per session, event handlers may wait on asynchronous requests. The shared client and pool must outlive the
+     * sessions using them.
      */
     class Session final
     {
     private:
-        uid_t qq_;
+        uid_t qq_ = 0;
         std::string key_;
-        std::unique_ptr<ws::Client> client_;
-        std::unique_ptr<asio::thread_pool> thread_pool_;
+        std::string body_prefix_; // Pre-encoded {"sessionKey":"..." beginning every POST body
+        std::shared_ptr<Transport> transport_;
+        bool recycle_events_ = false;
+        size_t backfill_events_ = 0;
+        EventQueuePolicy event_queue_;
+        std::vector<std::weak_ptr<EventQueue>> event_queues_; // Closed before the connections and the pool feeding them
+        std::shared_ptr<asio::thread_pool> shared_pool_;
+        std::unique_ptr<utils::Executor> thread_pool_;
+        std::unique_ptr<utils::Executor> request_pool_;
+
+        template <typename F>
+        auto post_request(F&& func) const;
+
+        utils::json get_json(std::string_view url,
+            utils::ArrayProxy<utils::QueryParameter> parameters) const;
+        utils::json post_json(std::string_view url,
+            const utils::json& json, bool idempotent = false) const;
+        template <typename F>
+        std::string post_fields(std::string_view url, F&& write_fields, bool idempotent = false) const;
 
         std::vector<std::string> send_image_message(utils::OptionalParam<uid_t> qq,
             utils::OptionalParam<gid_t> group,
@@ -33,9 +113,17 @@ namespace mirai
 
         std::vector<Event> get_events(std::string_view url, size_t count) const;
 
+        template <typename F>
+        static void invoke_event_callback(F& callback, const ws::AsioClient::message_ptr& msg, bool recycle);
+        static EventStorage& event_storage();
+        static bool accept_frame(EventTypeSet types, ws::Connection& connection, std::string_view payload);
+        static void backfill_events(Transport& transport, const std::string& session_key,
+            ws::Connection& connection, std::string_view url, detail::RecentFrames& recent);
+        void close_event_queues();
+
         template <typename F, typename E>
-        ws::Connection& subscribe(std::string_view url,
-            F&& callback, E&& error_handler, ExecutionPolicy policy);
+        ws::Connection& subscribe(std::string_view url, F&& callback, E&& error_handler,
+            ExecutionPolicy policy, EventTypeSet types = EventTypeSet::all());
     public:
         /**
          * \brief Construct a default invalid Session object
@@ -46,8 +134,9 @@ namespace mirai
          * \brief Start a new mirai-http session
          * \param auth_key The authorization key
          * \param qq The QQ ID for the bot
+         * \param settings Client side settings of the session
          */
-        Session(std::string_view auth_key, uid_t qq);
+        Session(std::string_view auth_key, uid_t qq, const SessionSettings& settings = {});
 
         /**
          * \brief Free the resource of a session
@@ -62,6 +151,7 @@ namespace mirai
         /**
          * \brief Take the ownership of a session from another object
          * \param other The other object
+         * \remarks The asynchronous requests pending on the other object are waited for
          */
         Session(Session&& other) noexcept;
 
@@ -109,6 +199,19 @@ namespace mirai
          */
         std::string_view key() const { return key_; }
 
+        /**
+         * \brief Get a snapshot of the HTTP request counters, including the
+         * retries and the circuit breaker activities
+         * \return The counters
+         */
+        utils::RequestStats request_stats() const;
+
+        /**
+         * \brief Get the transport this session talks to the server through
+         * \return Reference to the transport
+         */
+        Transport& transport() const { return *transport_; }
+
         /**
          * \brief Get an "At" message segment with the target being the bot
          * \return The message segment
@@ -124,12 +227,16 @@ namespace mirai
         /**
          * \brief Start the thread pool for future event processing
          * \param thread_count Thread count, leave as default for the default value
-         * \remarks This function does nothing if the thread pool is already running
+         * \remarks This function does nothing if the thread pool is already running.
+         * Giving a thread count when the session uses the thread pool shared through
+         * the settings is reported by throwing RuntimeError
          */
         void start_thread_pool(utils::OptionalParam<size_t> thread_count = {});
 
         /**
          * \brief Join all threads in the thread pool and destroy the pool
+         * \remarks The event queues feeding the pool are closed, the events received
+         * afterwards by their connections are discarded
          */
         void destroy_thread_pool();
 
@@ -137,7 +244,7 @@ namespace mirai
          * \brief Query whether the websocket client is started
          * \return The result
          */
-        bool websocket_client_started() const { return client_ != nullptr; }
+        bool websocket_client_started() const { return transport_ && transport_->websocket_started(); }
 
         /**
          * \brief Send message to a friend
@@ -149,6 +256,16 @@ namespace mirai
         msgid_t send_message(uid_t friend_, const Message& msg,
             utils::OptionalParam<msgid_t> quote = {}) const;
 
+        /**
+         * \brief Send message to a friend asynchronously
+         * \param friend_ Target QQ to send the message to
+         * \param msg The message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(uid_t friend_, Message msg,
+            std::optional<msgid_t> quote = {}) const;
+
         /**
          * \brief Send message to a temporary group member chat
          * \param qq Target QQ to send the message to
@@ -160,6 +277,17 @@ namespace mirai
         msgid_t send_message(uid_t qq, gid_t group, const Message& msg,
             utils::OptionalParam<msgid_t> quote = {}) const;
 
+        /**
+         * \brief Send message to a temporary group member chat asynchronously
+         * \param qq Target QQ to send the message to
+         * \param group Target group to start the temporary chat
+         * \param msg The message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(uid_t qq, gid_t group, Message msg,
+            std::optional<msgid_t> quote = {}) const;
+
         /**
          * \brief Send message to a group
          * \param target Target group to send the message to
@@ -170,6 +298,78 @@ namespace mirai
         msgid_t send_message(gid_t target, const Message& msg,
             utils::OptionalParam<msgid_t> quote = {}) const;
 
+        /**
+         * \brief Send message to a group asynchronously
+         * \param target Target group to send the message to
+         * \param msg The message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(gid_t target, Message msg,
+            std::optional<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a friend
+         * \param friend_ Target QQ to send the message to
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return The message ID of the message sent
+         */
+        msgid_t send_message(uid_t friend_, const PreparedMessage& msg,
+            utils::OptionalParam<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a friend asynchronously
+         * \param friend_ Target QQ to send the message to
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(uid_t friend_, PreparedMessage msg,
+            std::optional<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a temporary group member chat
+         * \param qq Target QQ to send the message to
+         * \param group Target group to start the temporary chat
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return The message ID of the message sent
+         */
+        msgid_t send_message(uid_t qq, gid_t group, const PreparedMessage& msg,
+            utils::OptionalParam<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a temporary group member chat asynchronously
+         * \param qq Target QQ to send the message to
+         * \param group Target group to start the temporary chat
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(uid_t qq, gid_t group, PreparedMessage msg,
+            std::optional<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a group
+         * \param target Target group to send the message to
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return The message ID of the message sent
+         */
+        msgid_t send_message(gid_t target, const PreparedMessage& msg,
+            utils::OptionalParam<msgid_t> quote = {}) const;
+
+        /**
+         * \brief Send a prepared message to a group asynchronously
+         * \param target Target group to send the message to
+         * \param msg The prepared message to send
+         * \param quote The message to be quoted (optional)
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_message_async(gid_t target, PreparedMessage msg,
+            std::optional<msgid_t> quote = {}) const;
+
         /**
          * \brief Quote reply a friend message
          * \param quote The friend message to quote
@@ -178,6 +378,14 @@ namespace mirai
          */
         msgid_t send_quote_message(const FriendMessage& quote, const Message& msg) const;
 
+        /**
+         * \brief Quote reply a friend message asynchronously
+         * \param quote The friend message to quote
+         * \param msg The message to send
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_quote_message_async(const FriendMessage& quote, Message msg) const;
+
         /**
          * \brief Quote reply a temporary message
          * \param quote The temporary message to quote
@@ -186,6 +394,14 @@ namespace mirai
          */
         msgid_t send_quote_message(const TempMessage& quote, const Message& msg) const;
 
+        /**
+         * \brief Quote reply a temporary message asynchronously
+         * \param quote The temporary message to quote
+         * \param msg The message to send
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_quote_message_async(const TempMessage& quote, Message msg) const;
+
         /**
          * \brief Quote reply a group message
          * \param quote The group message to quote
@@ -194,6 +410,14 @@ namespace mirai
          */
         msgid_t send_quote_message(const GroupMessage& quote, const Message& msg) const;
 
+        /**
+         * \brief Quote reply a group message asynchronously
+         * \param quote The group message to quote
+         * \param msg The message to send
+         * \return A future of the message ID of the message sent
+         */
+        std::future<msgid_t> send_quote_message_async(const GroupMessage& quote, Message msg) const;
+
         /**
          * \brief Send images to a friend via URLs
          * \param friend_ Target QQ to send the message to
@@ -205,6 +429,15 @@ namespace mirai
         std::vector<std::string> send_image_message(uid_t friend_,
             utils::ArrayProxy<std::string> urls) const;
 
+        /**
+         * \brief Send images to a friend via URLs asynchronously
+         * \param friend_ Target QQ to send the message to
+         * \param urls Image URLs
+         * \return A future of the ID list of the images
+         */
+        std::future<std::vector<std::string>> send_image_message_async(uid_t friend_,
+            std::vector<std::string> urls) const;
+
         /**
          * \brief Send images to a group via URLs
          * \param group Target group to send the message to
@@ -216,6 +449,15 @@ namespace mirai
         std::vector<std::string> send_image_message(gid_t group,
             utils::ArrayProxy<std::string> urls) const;
 
+        /**
+         * \brief Send images to a group via URLs asynchronously
+         * \param group Target group to send the message to
+         * \param urls Image URLs
+         * \return A future of the ID list of the images
+         */
+        std::future<std::vector<std::string>> send_image_message_async(gid_t group,
+            std::vector<std::string> urls) const;
+
         /**
          * \brief Send images to a temporary chat via URLs
          * \param qq Target QQ
@@ -228,6 +470,16 @@ namespace mirai
         std::vector<std::string> send_image_message(uid_t qq, gid_t group,
             utils::ArrayProxy<std::string> urls) const;
 
+        /**
+         * \brief Send images to a temporary chat via URLs asynchronously
+         * \param qq Target QQ
+         * \param group Target group
+         * \param urls Image URLs
+         * \return A future of the ID list of the images
+         */
+        std::future<std::vector<std::string>> send_image_message_async(uid_t qq, gid_t group,
+            std::vector<std::string> urls) const;
+
         /**
          * \brief Upload an image to the server
          * \param type Target type (friend, group or temp)
@@ -238,6 +490,14 @@ namespace mirai
          */
         msg::Image upload_image(TargetType type, const std::string& path) const;
 
+        /**
+         * \brief Upload an image to the server asynchronously
+         * \param type Target type (friend, group or temp)
+         * \param path The path to the image file
+         * \return A future of the image ID and other info about the image
+         */
+        std::future<msg::Image> upload_image_async(TargetType type, std::string path) const;
+
         /**
          * \brief Recall a message
          * \param message_id The ID of the message to recall
@@ -245,6 +505,13 @@ namespace mirai
          */
         void recall(msgid_t message_id) const;
 
+        /**
+         * \brief Recall a message asynchronously
+         * \param message_id The ID of the message to recall
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> recall_async(msgid_t message_id) const;
+
         /**
          * \brief Pop oldest events from the event queue
          * \param count Amount of events to get
@@ -252,6 +519,13 @@ namespace mirai
          */
         std::vector<Event> fetch_events(size_t count = 10) const;
 
+        /**
+         * \brief Pop oldest events from the event queue asynchronously
+         * \param count Amount of events to get
+         * \return A future of the events
+         */
+        std::future<std::vector<Event>> fetch_events_async(size_t count = 10) const;
+
         /**
          * \brief Pop latest events from the event queue
          * \param count Amount of events to get
@@ -259,6 +533,13 @@ namespace mirai
          */
         std::vector<Event> fetch_latest_events(size_t count = 10) const;
 
+        /**
+         * \brief Pop latest events from the event queue asynchronously
+         * \param count Amount of events to get
+         * \return A future of the events
+         */
+        std::future<std::vector<Event>> fetch_latest_events_async(size_t count = 10) const;
+
         /**
          * \brief Peek oldest events from the event queue
          * \param count Amount of events to get
@@ -266,6 +547,13 @@ namespace mirai
          */
         std::vector<Event> peek_events(size_t count = 10) const;
 
+        /**
+         * \brief Peek oldest events from the event queue asynchronously
+         * \param count Amount of events to get
+         * \return A future of the events
+         */
+        std::future<std::vector<Event>> peek_events_async(size_t count = 10) const;
+
         /**
          * \brief Peek latest events from the event queue
          * \param count Amount of events to get
@@ -273,12 +561,25 @@ namespace mirai
          */
         std::vector<Event> peek_latest_events(size_t count = 10) const;
 
+        /**
+         * \brief Peek latest events from the event queue asynchronously
+         * \param count Amount of events to get
+         * \return A future of the events
+         */
+        std::future<std::vector<Event>> peek_latest_events_async(size_t count = 10) const;
+
         /**
          * \brief Count remaining events in the event queue
          * \return The count
          */
         size_t count_events() const;
 
+        /**
+         * \brief Count remaining events in the event queue asynchronously
+         * \return A future of the count
+         */
+        std::future<size_t> count_events_async() const;
+
         /**
          * \brief Get the content of a message from its ID
          * \param id The ID of the message
@@ -286,18 +587,37 @@ namespace mirai
          */
         Event message_from_id(msgid_t id) const;
 
+        /**
+         * \brief Get the content of a message from its ID asynchronously
+         * \param id The ID of the message
+         * \return A future of the message object
+         */
+        std::future<Event> message_from_id_async(msgid_t id) const;
+
         /**
          * \brief Get the friend list of the bot
          * \return A vector of friends
          */
         std::vector<Friend> friend_list() const;
 
+        /**
+         * \brief Get the friend list of the bot asynchronously
+         * \return A future of the friends
+         */
+        std::future<std::vector<Friend>> friend_list_async() const;
+
         /**
          * \brief Get the group list of the bot
          * \return A vector of groups
          */
         std::vector<Group> group_list() const;
 
+        /**
+         * \brief Get the group list of the bot asynchronously
+         * \return A future of the groups
+         */
+        std::future<std::vector<Group>> group_list_async() const;
+
         /**
          * \brief Get the member list of a group
          * \param target The group ID
@@ -305,18 +625,39 @@ namespace mirai
          */
         std::vector<Member> member_list(gid_t target) const;
 
+        /**
+         * \brief Get the member list of a group asynchronously
+         * \param target The group ID
+         * \return A future of the members
+         */
+        std::future<std::vector<Member>> member_list_async(gid_t target) const;
+
         /**
          * \brief Mute a group
          * \param target The group ID
          */
         void mute_all(gid_t target) const;
 
+        /**
+         * \brief Mute a group asynchronously
+         * \param target The group ID
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> mute_all_async(gid_t target) const;
+
         /**
          * \brief Unmute a group
          * \param target The group ID
          */
         void unmute_all(gid_t target) const;
 
+        /**
+         * \brief Unmute a group asynchronously
+         * \param target The group ID
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> unmute_all_async(gid_t target) const;
+
         /**
          * \brief Mute a group member
          * \param group The group ID
@@ -325,6 +666,16 @@ namespace mirai
          */
         void mute(gid_t group, uid_t member, std::chrono::seconds duration = {}) const;
 
+        /**
+         * \brief Mute a group member asynchronously
+         * \param group The group ID
+         * \param member The member ID
+         * \param duration Mute duration
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> mute_async(gid_t group, uid_t member,
+            std::chrono::seconds duration = {}) const;
+
         /**
          * \brief Unmute a group member
          * \param group The group ID
@@ -332,6 +683,14 @@ namespace mirai
          */
         void unmute(gid_t group, uid_t member) const;
 
+        /**
+         * \brief Unmute a group member asynchronously
+         * \param group The group ID
+         * \param member The member ID
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> unmute_async(gid_t group, uid_t member) const;
+
         /**
          * \brief Kick a group member
          * \param group The group ID
@@ -340,12 +699,28 @@ namespace mirai
          */
         void kick(gid_t group, uid_t member, std::string_view message = "") const;
 
+        /**
+         * \brief Kick a group member asynchronously
+         * \param group The group ID
+         * \param member The member ID
+         * \param message The remark message for kicking the member
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> kick_async(gid_t group, uid_t member, std::string message = "") const;
+
         /**
          * \brief Quit from a group chat
          * \param group The group ID
          */
         void quit(gid_t group) const;
 
+        /**
+         * \brief Quit from a group chat asynchronously
+         * \param group The group ID
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> quit_async(gid_t group) const;
+
         /**
          * \brief Respond to a new friend request event
          * \param event The event to respond to
@@ -355,6 +730,16 @@ namespace mirai
         void respond_new_friend_request(const NewFriendRequestEvent& event,
             NewFriendResponseType type, std::string_view message) const;
 
+        /**
+         * \brief Respond to a new friend request event asynchronously
+         * \param event The event to respond to
+         * \param type Type of the response
+         * \param message The additional message
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> respond_new_friend_request_async(NewFriendRequestEvent event,
+            NewFriendResponseType type, std::string message) const;
+
         /**
          * \brief Respond to a member join request event
          * \param event The event to respond to
@@ -364,6 +749,16 @@ namespace mirai
         void respond_member_join_request(const MemberJoinRequestEvent& event,
             MemberJoinResponseType type, std::string_view message) const;
 
+        /**
+         * \brief Respond to a member join request event asynchronously
+         * \param event The event to respond to
+         * \param type Type of the response
+         * \param message The additional message
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> respond_member_join_request_async(MemberJoinRequestEvent event,
+            MemberJoinResponseType type, std::string message) const;
+
         /**
          * \brief Set a group's config
          * \param target The group ID
@@ -371,6 +766,14 @@ namespace mirai
          */
         void group_config(gid_t target, const GroupConfig& config) const;
 
+        /**
+         * \brief Set a group's config asynchronously
+         * \param target The group ID
+         * \param config The config to set
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> group_config_async(gid_t target, GroupConfig config) const;
+
         /**
          * \brief Get a group's config
          * \param target The group ID
@@ -378,6 +781,13 @@ namespace mirai
          */
         GroupConfig group_config(gid_t target) const;
 
+        /**
+         * \brief Get a group's config asynchronously
+         * \param target The group ID
+         * \return A future of the result
+         */
+        std::future<GroupConfig> group_config_async(gid_t target) const;
+
         /**
          * \brief Modify a group member's info
          * \param group The group ID
@@ -389,6 +799,18 @@ namespace mirai
             utils::OptionalParam<std::string_view> name,
             utils::OptionalParam<std::string_view> special_title) const;
 
+        /**
+         * \brief Modify a group member's info asynchronously
+         * \param group The group ID
+         * \param member The member ID
+         * \param name The new name for the member
+         * \param special_title The new special title for the member
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> member_info_async(gid_t group, uid_t member,
+            std::optional<std::string> name,
+            std::optional<std::string> special_title) const;
+
         /**
          * \brief Get a group member's info
          * \param group The group ID
@@ -397,15 +819,25 @@ namespace mirai
          */
         MemberInfo member_info(gid_t group, uid_t member) const;
 
+        /**
+         * \brief Get a group member's info asynchronously
+         * \param group The group ID
+         * \param member The member ID
+         * \return A future of the result
+         */
+        std::future<MemberInfo> member_info_async(gid_t group, uid_t member) const;
+
         /**
          * \brief Close the websocket client, outstanding connections will
          * also be closed
+         * \remarks The event queues are closed first, so that pushes blocked by
+         * OverflowPolicy::block do not keep the connections from closing
          */
-        void close_websocket_client() { client_.reset(); }
+        void close_websocket_client();
 
         /**
          * \brief Close a WebSocket connection
-         * \param connection The connection
+         * \param connection The connection, it must not be used after closing
          */
         void close_connection(ws::Connection& connection);
 
@@ -413,7 +845,7 @@ namespace mirai
          * \brief Listen on message events received using the callback
          * \tparam F Type of the callback
          * \tparam E Type of the error handler
-         * \param callback The callback
+         * \param callback The callback, taking an Event& or a LazyEvent& to decode the events lazily
          * \param error_handler The error handler
          * \param policy Execution policy of this connection
          * \returns The Websocket connection
@@ -423,7 +855,7 @@ namespace mirai
          * application will abort.
          */
         template <typename F, typename E,
-            std::invoke_result_t<F, Event&>* = nullptr,
+            detail::event_callback_t<F>* = nullptr,
             std::invoke_result_t<E>* = nullptr>
         ws::Connection& subscribe_messages(F&& callback, E&& error_handler,
             ExecutionPolicy policy = ExecutionPolicy::single_thread);
@@ -432,7 +864,7 @@ namespace mirai
          * \brief Listen on non-message events received using the callback
          * \tparam F Type of the callback
          * \tparam E Type of the error handler
-         * \param callback The callback
+         * \param callback The callback, taking an Event& or a LazyEvent& to decode the events lazily
          * \param error_handler The error handler
          * \param policy Execution policy of this connection
          * \returns The Websocket connection
@@ -442,7 +874,7 @@ namespace mirai
          * the application will abort.
          */
         template <typename F, typename E,
-            std::invoke_result_t<F, Event&>* = nullptr,
+            detail::event_callback_t<F>* = nullptr,
             std::invoke_result_t<E>* = nullptr>
         ws::Connection& subscribe_non_message(F&& callback, E&& error_handler,
             ExecutionPolicy policy = ExecutionPolicy::single_thread);
@@ -451,7 +883,7 @@ namespace mirai
          * \brief Listen on all events received using the callback
          * \tparam F Type of the callback
          * \tparam E Type of the error handler
-         * \param callback The callback
+         * \param callback The callback, taking an Event& or a LazyEvent& to decode the events lazily
          * \param error_handler The error handler
          * \param policy Execution policy of this connection
          * \returns The Websocket connection
@@ -461,46 +893,103 @@ namespace mirai
          * will abort.
          */
         template <typename F, typename E,
-            std::invoke_result_t<F, Event&>* = nullptr,
+            detail::event_callback_t<F>* = nullptr,
             std::invoke_result_t<E>* = nullptr>
         ws::Connection& subscribe_all_events(F&& callback, E&& error_handler,
             ExecutionPolicy policy = ExecutionPolicy::single_thread);
 
+        /**
+         * \brief Listen on events of certain types received using the callback
+         * \details Only the "type" member of each payload is scanned before decoding,
+         * events of the other types are dropped right away and counted by
+         * Connection::filtered_frames(). The connection listens on messages or
+         * non-message events only if the types allow.
+         * \tparam F Type of the callback
+         * \tparam E Type of the error handler
+         * \param types The event types to listen on
+         * \param callback The callback, taking an Event& or a LazyEvent& to decode the events lazily
+         * \param error_handler The error handler
+         * \param policy Execution policy of this connection
+         * \returns The Websocket connection
+         * \remarks The callback should be able to visit variants with
+         * all of the event types in the set. The events will be handled on
+         * another thread, so if any exception is not handled the application
+         * will abort.
+         */
+        template <typename F, typename E,
+            detail::event_callback_t<F>* = nullptr,
+            std::invoke_result_t<E>* = nullptr>
+        ws::Connection& subscribe_events(EventTypeSet types, F&& callback, E&& error_handler,
+            ExecutionPolicy policy = ExecutionPolicy::single_thread);
+
         /**
          * \brief Set the config of this session, leave parameters as default for
          * not changing that setting
          * \param cache_size The new cache size
          * \param enable_websocket Whether to enable websocket
          */
-        void config(utils::OptionalParam<size_t> cache_size = {},
+        void config(utils::OptionalParam<size_t> cache_size,
             utils::OptionalParam<bool> enable_websocket = {}) const;
 
+        /**
+         * \brief Set the config of this session asynchronously, leave parameters
+         * as default for not changing that setting
+         * \param cache_size The new cache size
+         * \param enable_websocket Whether to enable websocket
+         * \return A future for waiting the completion of the request
+         */
+        std::future<void> config_async(std::optional<size_t> cache_size,
+            std::optional<bool> enable_websocket = {}) const;
+
         /**
          * \brief Get the config of this session
          * \return The config
          */
         SessionConfig config() const;
+
+        /**
+         * \brief Get the config of this session asynchronously
+         * \return A future of the config
+         */
+        std::future<SessionConfig> config_async() const;
     };
 
+    template <typename F>
+    void Session::invoke_event_callback(F& callback, const ws::AsioClient::message_ptr& msg, const bool recycle)
+    {
+        if constexpr (std::is_invocable_v<F&, Event&>)
+        {
+            if (recycle)
+                callback(event_storage().decode(msg->get_payload()));
+            else
+            {
+                Event e = parse_event(msg->get_payload());
+                callback(e);
+            }
+        }
+        else
+        {
+            // Share the payload with the message instead of copying it
+            LazyEvent e(std::shared_ptr<const std::string>(msg, &msg->get_payload()));
+            callback(e);
+        }
+    }
+
     template <typename F, typename E>
-    ws::Connection& Session::subscribe(const std::string_view url,
-        F&& callback, E&& error_handler, const ExecutionPolicy policy)
+    ws::Connection& Session::subscribe(const std::string_view url, F&& callback,
+        E&& error_handler, const ExecutionPolicy policy, const EventTypeSet types)
     {
         using MsgPtr = ws::AsioClient::message_ptr;
-        if (!client_) client_ = std::make_unique<ws::Client>();
-        const std::string uri = utils::strcat("ws://", base_url, url, "?sessionKey=", key_);
-        ws::Connection& con = client_->connect(uri);
+        ws::Connection& con = transport_->connect(utils::strcat(url, "?sessionKey=", key_));
         if (policy == ExecutionPolicy::single_thread)
         {
-            con.message_callback([callback = std::forward<F>(callback),
+            con.message_callback([&con, types, recycle = recycle_events_, callback = std::forward<F>(callback),
                     error_handler = std::forward<E>(error_handler)](const MsgPtr& msg)
                 {
                     try
                     {
-                        const utils::json json = utils::json::parse(msg->get_payload());
-                        utils::check_response(json);
-                        Event e = json.get<Event>();
-                        callback(e);
+                        if (!accept_frame(types, con, msg->get_payload())) return;
+                        invoke_event_callback(callback, msg, recycle);
                     }
                     catch (...) { error_handler(); }
                 });
@@ -509,33 +998,71 @@ namespace mirai
         {
             if (!thread_pool_) start_thread_pool();
             // Wrap everything into shared_ptrs to avoid lifetime issues
-            con.message_callback([
-                    &pool = *thread_pool_,
-                    callback = std::make_shared<std::decay_t<F>>(std::forward<F>(callback)),
-                    error_handler = std::make_shared<std::decay_t<E>>(std::forward<E>(error_handler))
-                ](const MsgPtr& msg)
-                {
-                    try
+            auto callback_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(callback));
+            auto error_handler_ptr = std::make_shared<std::decay_t<E>>(std::forward<E>(error_handler));
+            if (event_queue_.capacity == 0)
+            {
+                con.message_callback([
+                        &pool = *thread_pool_, &con, types, recycle = recycle_events_,
+                        callback = std::move(callback_ptr), error_handler = std::move(error_handler_ptr)
+                    ](const MsgPtr& msg)
                     {
-                        asio::post(pool, [=]() // Copy the shared_ptrs to make them alive
+                        try
                         {
-                            try
+                            if (!accept_frame(types, con, msg->get_payload())) return;
+                            // Copy the shared_ptrs to make them alive
+                            pool.post([callback, error_handler, msg, recycle]()
                             {
-                                const utils::json json = utils::json::parse(msg->get_payload());
-                                utils::check_response(json);
-                                Event e = json.get<Event>();
-                                (*callback)(e);
-                            }
-                            catch (...) { (*error_handler)(); }
-                        });
-                    }
-                    catch (...) { (*error_handler)(); }
-                });
+                                try
+                                {
+                                    invoke_event_callback(*callback, msg, recycle);
+                                }
+                                catch (...) { (*error_handler)(); }
+                            });
+                        }
+                        catch (...) { (*error_handler)(); }
+                    });
+            }
+            else
+            {
+                auto queue = std::make_shared<EventQueue>(event_queue_, *thread_pool_,
+                    [callback = callback_ptr, error_handler = error_handler_ptr, recycle = recycle_events_](
+                        const MsgPtr& msg)
+                    {
+                        try
+                        {
+                            invoke_event_callback(*callback, msg, recycle);
+                        }
+                        catch (...) { (*error_handler)(); }
+                    }, con.queue_counters());
+                event_queues_.push_back(queue);
+                con.message_callback([&con, types, queue = std::move(queue),
+                        error_handler = std::move(error_handler_ptr)](const MsgPtr& msg)
+                    {
+                        try
+                        {
+                            if (!accept_frame(types, con, msg->get_payload())) return;
+                            queue->push(msg);
+                        }
+                        catch (...) { (*error_handler)(); }
+                    });
+            }
+        }
+        if (backfill_events_ != 0)
+        {
+            auto recent = std::make_shared<detail::RecentFrames>(backfill_events_);
+            con.message_callback([recent, callback = con.message_callback()](const MsgPtr& msg)
+            {
+                recent->insert(msg->get_payload());
+                (*callback)(msg);
+            });
+            con.reconnect_callback([&transport = *transport_, &con, key = key_, url = std::string(url),
+                recent = std::move(recent)]() { backfill_events(transport, key, con, url, *recent); });
         }
         return con;
     }
 
-    template <typename F, typename E, std::invoke_result_t<F, Event&>*, std::invoke_result_t<E>*>
+    template <typename F, typename E, detail::event_callback_t<F>*, std::invoke_result_t<E>*>
     ws::Connection& Session::subscribe_messages(F&& callback, E&& error_handler,
         const ExecutionPolicy policy)
     {
@@ -543,7 +1070,7 @@ namespace mirai
             std::forward<F>(callback), std::forward<E>(error_handler), policy);
     }
 
-    template <typename F, typename E, std::invoke_result_t<F, Event&>*, std::invoke_result_t<E>*>
+    template <typename F, typename E, detail::event_callback_t<F>*, std::invoke_result_t<E>*>
     ws::Connection& Session::subscribe_non_message(F&& callback, E&& error_handler,
         const ExecutionPolicy policy)
     {
@@ -551,11 +1078,22 @@ namespace mirai
             std::forward<F>(callback), std::forward<E>(error_handler), policy);
     }
 
-    template <typename F, typename E, std::invoke_result_t<F, Event&>*, std::invoke_result_t<E>*>
+    template <typename F, typename E, detail::event_callback_t<F>*, std::invoke_result_t<E>*>
     ws::Connection& Session::subscribe_all_events(F&& callback, E&& error_handler,
         const ExecutionPolicy policy)
     {
         return subscribe("/all",
             std::forward<F>(callback), std::forward<E>(error_handler), policy);
     }
+
+    template <typename F, typename E, detail::event_callback_t<F>*, std::invoke_result_t<E>*>
+    ws::Connection& Session::subscribe_events(const EventTypeSet types, F&& callback, E&& error_handler,
+        const ExecutionPolicy policy)
+    {
+        // Let the server filter out the category of events not needed
+        const std::string_view url =
+            types.is_subset_of(EventTypeSet::messages()) ? "/message" :
+            (types & EventTypeSet::messages()).empty() ? "/event" : "/all";
+        return subscribe(url, std::forward<F>(callback), std::forward<E>(error_handler), policy, types);
+    }
 }
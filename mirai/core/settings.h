@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <asio/thread_pool.hpp>
+#include "common.h"
+#include "event_queue.h"
+#include "../utils/request.h"
+
+namespace mirai
+{
+    class Transport;
+
+    namespace ws
+    {
+        class Client;
+    }
+
+    /**
+     * \brief Client side settings of a session, they are fixed once the session
+     * is constructed
+     */
+    struct SessionSettings final
+    {
+        std::string host = base_url; ///< Host of the mirai-http-api server, e.g. "localhost:8080"
+        size_t max_connections = 0; ///< Maximum amount of kept-alive HTTP connections, 0 for the hardware concurrency
+        utils::RetryPolicy retry; ///< Retry policy of idempotent HTTP requests, no retry by default
+        utils::CircuitBreakerPolicy circuit_breaker; ///< Policy of the per-endpoint circuit breakers, disabled by default
+        utils::TimeoutPolicy timeout; ///< Connect timeout and deadline of every HTTP request, no limit by default
+        size_t websocket_threads = 1; ///< Amount of threads running the WebSocket I/O, 0 for the hardware concurrency
+        utils::ReconnectPolicy reconnect; ///< Policy of reestablishing dropped WebSocket connections, disabled by default
+        bool websocket_compression = false; ///< Offer permessage-deflate on WebSocket connections, needs the library built with MIRAIPP_WEBSOCKET_DEFLATE
+        std::chrono::milliseconds ping_interval{ 0 }; ///< Interval of pinging the WebSocket connections to measure the round-trip time, 0 to disable pinging
+        size_t backfill_events = 0; ///< Maximum amount of events peeked through peek_latest_events after reconnecting, 0 to disable backfilling
+        std::shared_ptr<ws::Client> websocket_client; ///< WebSocket client shared with other sessions, null for a client owned by the NetworkTransport
+        std::shared_ptr<asio::thread_pool> executor; ///< Thread pool shared with other sessions for handling events, null for a pool owned by the session. Asynchronous requests always run on a pool of the session, so that handlers waiting on them cannot starve them
+        std::shared_ptr<Transport> transport; ///< Custom transport, null for a NetworkTransport built from the settings above
+        EventQueuePolicy event_queue; ///< Policy of the queue of the events handled on the thread pool, unbounded by default
+        bool recycle_events = false; ///< Decode WebSocket events into an EventStorage of each thread instead of fresh Event objects
+    };
+}
@@ -0,0 +1,73 @@
+#include "transport.h"
+#include <algorithm>
+#include "common.h"
+#include "../utils/string.h"
+
+namespace mirai
+{
+    NetworkTransport::NetworkTransport(const std::string_view host, const size_t max_connections,
+        const utils::RetryPolicy& retry, const utils::CircuitBreakerPolicy& circuit_breaker,
+        const utils::TimeoutPolicy& timeouts, const ws::ClientOptions& websocket,
+        std::shared_ptr<ws::Client> client):
+        http_(host, max_connections, retry, circuit_breaker, timeouts),
+        ws_url_(utils::strcat("ws://", host)), websocket_(websocket), shared_client_(std::move(client)) {}
+
+    std::string NetworkTransport::get(const std::string_view url,
+        const utils::ArrayProxy<utils::QueryParameter> parameters)
+    {
+        return http_.get(url, parameters);
+    }
+
+    std::string NetworkTransport::post_json(const std::string_view url,
+        const std::string_view body, const bool idempotent)
+    {
+        return http_.post_json(url, body, idempotent);
+    }
+
+    std::string NetworkTransport::post_multipart(const std::string_view url,
+        const utils::ArrayProxy<utils::FormField> fields)
+    {
+        return http_.post_multipart(url, fields);
+    }
+
+    size_t NetworkTransport::concurrency() const { return http_.connection_pool().max_size(); }
+
+    utils::RequestStats NetworkTransport::request_stats() const { return http_.stats(); }
+
+    ws::Connection& NetworkTransport::connect(const std::string_view url)
+    {
+        if (!client_) client_ = shared_client_ ? shared_client_ : std::make_shared<ws::Client>(websocket_);
+        ws::Connection& connection = client_->connect(utils::strcat(ws_url_, url));
+        connections_.push_back(&connection);
+        return connection;
+    }
+
+    void NetworkTransport::close(ws::Connection& connection)
+    {
+        if (!client_) throw RuntimeError("The WebSocket client is not started");
+        client_->close(connection);
+        // The I/O threads must not call into the owner of the callbacks after closing
+        connection.detach();
+        // The client keeps the connection alive as long as its underlying connection needs it
+        connections_.erase(std::remove(connections_.begin(), connections_.end(), &connection), connections_.end());
+        client_->release(connection);
+    }
+
+    void NetworkTransport::close_websocket()
+    {
+        if (client_ && client_ == shared_client_)
+        {
+            // The client outlives this transport, so close the connections opened through
+            // this transport and make sure that their callbacks are never called again
+            for (ws::Connection* connection : connections_)
+            {
+                try { if (!connection->ended()) client_->close(*connection); }
+                catch (const RuntimeError&) {}
+                connection->detach();
+                client_->release(*connection);
+            }
+        }
+        connections_.clear();
+        client_.reset();
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "websockets/client.h"
+#include "../utils/request.h"
+
+namespace mirai
+{
+    /**
+     * \brief Interface of the transport a session talks to the mirai-http-api
+     * server through, covering both the HTTP requests and the WebSocket connections
+     * \details All the URLs are relative to the server, e.g. "/friendList".
+     * Requests are issued concurrently from multiple threads, so implementations
+     * must be thread safe. Failed requests are reported by throwing RuntimeError,
+     * or TimeoutError if the request does not complete before its deadline.
+     */
+    class Transport
+    {
+    public:
+        /**
+         * \brief Default constructor
+         */
+        Transport() = default;
+
+        /**
+         * \brief Destroy the transport
+         */
+        virtual ~Transport() noexcept = default;
+
+        /**
+         * \brief Transports cannot be copied
+         */
+        Transport(const Transport&) = delete;
+
+        /**
+         * \brief Transports cannot be moved
+         */
+        Transport(Transport&&) = delete;
+
+        /**
+         * \brief Transports cannot be copied
+         */
+        Transport& operator=(const Transport&) = delete;
+
+        /**
+         * \brief Transports cannot be moved
+         */
+        Transport& operator=(Transport&&) = delete;
+
+        /**
+         * \brief Send a GET request
+         * \param url The URL
+         * \param parameters The query parameters
+         * \return The response text
+         */
+        virtual std::string get(std::string_view url, utils::ArrayProxy<utils::QueryParameter> parameters) = 0;
+
+        /**
+         * \brief Send a POST request with a JSON body
+         * \param url The URL
+         * \param body The serialized JSON body
+         * \param idempotent Whether the request can be retried safely
+         * \return The response text
+         */
+        virtual std::string post_json(std::string_view url, std::string_view body, bool idempotent) = 0;
+
+        /**
+         * \brief Send a POST request with multipart form data
+         * \param url The URL
+         * \param fields The form fields
+         * \return The response text
+         */
+        virtual std::string post_multipart(std::string_view url, utils::ArrayProxy<utils::FormField> fields) = 0;
+
+        /**
+         * \brief Get the amount of requests this transport could handle at the same time
+         * \return The amount, sessions size their asynchronous request pools with it
+         */
+        virtual size_t concurrency() const = 0;
+
+        /**
+         * \brief Get a snapshot of the request counters
+         * \return The counters
+         */
+        virtual utils::RequestStats request_stats() const = 0;
+
+        /**
+         * \brief Open a WebSocket connection
+         * \param url The URL, including the query string
+         * \return A reference to the connection, it stays valid until the
+         * connection or the WebSocket side of the transport is closed
+         */
+        virtual ws::Connection& connect(std::string_view url) = 0;
+
+        /**
+         * \brief Close a WebSocket connection opened by this transport, the
+         * transport may release the connection, invalidating references to it
+         * \param connection The connection
+         */
+        virtual void close(ws::Connection& connection) = 0;
+
+        /**
+         * \brief Close all the WebSocket connections and release the resources
+         * for them, references to the connections are invalidated
+         */
+        virtual void close_websocket() = 0;
+
+        /**
+         * \brief Check whether the WebSocket side of the transport is started
+         * \return The result
+         */
+        virtual bool websocket_started() const = 0;
+    };
+
+    /**
+     * \brief The transport talking to a mirai-http-api server over the network,
+     * using a pooled HTTP client and a WebSocket client started on demand
+     */
+    class NetworkTransport final : public Transport
+    {
+    private:
+        utils::HttpClient http_;
+        std::string ws_url_;
+        ws::ClientOptions websocket_;
+        std::shared_ptr<ws::Client> shared_client_;
+        std::shared_ptr<ws::Client> client_;
+        std::vector<ws::Connection*> connections_; // Connections opened through this transport
+    public:
+        /**
+         * \brief Construct a network transport
+         * \param host Host of the server, e.g. "localhost:8080"
+         * \param max_connections Maximum amount of kept-alive HTTP connections,
+         * 0 for the hardware concurrency
+         * \param retry The retry policy for idempotent requests
+         * \param circuit_breaker The policy of the per-endpoint circuit breakers
+         * \param timeouts The timeouts of the HTTP requests
+         * \param websocket The options of the WebSocket client
+         * \param client A WebSocket client shared with other transports, in which case the
+         * options in the websocket parameter are ignored, or nullptr for a client owned by this transport
+         */
+        NetworkTransport(std::string_view host, size_t max_connections,
+            const utils::RetryPolicy& retry = {}, const utils::CircuitBreakerPolicy& circuit_breaker = {},
+            const utils::TimeoutPolicy& timeouts = {}, const ws::ClientOptions& websocket = {},
+            std::shared_ptr<ws::Client> client = nullptr);
+
+        /**
+         * \brief Get the underlying HTTP client
+         * \return Reference to the client
+         */
+        utils::HttpClient& http_client() { return http_; }
+
+        std::string get(std::string_view url, utils::ArrayProxy<utils::QueryParameter> parameters) override;
+        std::string post_json(std::string_view url, std::string_view body, bool idempotent) override;
+        std::string post_multipart(std::string_view url, utils::ArrayProxy<utils::FormField> fields) override;
+        size_t concurrency() const override;
+        utils::RequestStats request_stats() const override;
+        ws::Connection& connect(std::string_view url) override;
+        void close(ws::Connection& connection) override;
+        void close_websocket() override;
+        bool websocket_started() const override { return client_ != nullptr; }
+    };
+}
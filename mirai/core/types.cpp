@@ -24,6 +24,48 @@ namespace mirai
         json.at("remark").get_to(value.remark);
     }
 
+    void read_json(utils::JsonReader& reader, Permission& value)
+    {
+        const std::string_view str = reader.read_string();
+        if (str == "ADMINISTRATOR") value = Permission::administrator;
+        else if (str == "OWNER") value = Permission::owner;
+        else value = Permission::member; // Unknown values map to the first one as nlohmann does
+    }
+
+    void read_json(utils::JsonReader& reader, Group& value)
+    {
+        reader.read_object({ "id", "name", "permission" }, [&](const std::string_view key)
+        {
+            if (key == "id") read_json(reader, value.id);
+            else if (key == "name") read_json(reader, value.name);
+            else if (key == "permission") read_json(reader, value.permission);
+            else reader.skip();
+        });
+    }
+
+    void read_json(utils::JsonReader& reader, Member& value)
+    {
+        reader.read_object({ "id", "memberName", "permission", "group" }, [&](const std::string_view key)
+        {
+            if (key == "id") read_json(reader, value.id);
+            else if (key == "memberName") read_json(reader, value.member_name);
+            else if (key == "permission") read_json(reader, value.permission);
+            else if (key == "group") read_json(reader, value.group);
+            else reader.skip();
+        });
+    }
+
+    void read_json(utils::JsonReader& reader, Friend& value)
+    {
+        reader.read_object({ "id", "nickname", "remark" }, [&](const std::string_view key)
+        {
+            if (key == "id") read_json(reader, value.id);
+            else if (key == "nickname") read_json(reader, value.nickname);
+            else if (key == "remark") read_json(reader, value.remark);
+            else reader.skip();
+        });
+    }
+
     void to_json(utils::json& json, const GroupConfig& value)
     {
         json = {
@@ -46,6 +88,33 @@ namespace mirai
         json.at("anonymousChat").get_to(value.anonymous_chat);
     }
 
+    void read_json(utils::JsonReader& reader, GroupConfig& value)
+    {
+        reader.read_object({ "name", "announcement", "confessTalk",
+            "allowMemberInvite", "autoApprove", "anonymousChat" }, [&](const std::string_view key)
+        {
+            if (key == "name") read_json(reader, value.name);
+            else if (key == "announcement") read_json(reader, value.announcement);
+            else if (key == "confessTalk") read_json(reader, value.confess_talk);
+            else if (key == "allowMemberInvite") read_json(reader, value.allow_member_invite);
+            else if (key == "autoApprove") read_json(reader, value.auto_approve);
+            else if (key == "anonymousChat") read_json(reader, value.anonymous_chat);
+            else reader.skip();
+        });
+    }
+
+    void write_json(utils::JsonWriter& writer, const GroupConfig& value)
+    {
+        writer.begin_object();
+        writer.write_field("name", value.name);
+        writer.write_field("announcement", value.announcement);
+        writer.write_field("confessTalk", value.confess_talk);
+        writer.write_field("allowMemberInvite", value.allow_member_invite);
+        writer.write_field("autoApprove", value.auto_approve);
+        writer.write_field("anonymousChat", value.anonymous_chat);
+        writer.end_object();
+    }
+
     void to_json(utils::json& json, const MemberInfo& value)
     {
         json = {
@@ -60,6 +129,16 @@ namespace mirai
         json.at("specialTitle").get_to(value.special_title);
     }
 
+    void read_json(utils::JsonReader& reader, MemberInfo& value)
+    {
+        reader.read_object({ "name", "specialTitle" }, [&](const std::string_view key)
+        {
+            if (key == "name") read_json(reader, value.name);
+            else if (key == "specialTitle") read_json(reader, value.special_title);
+            else reader.skip();
+        });
+    }
+
     void to_json(utils::json& json, const SessionConfig& value)
     {
         json = {
@@ -73,4 +152,14 @@ namespace mirai
         json.at("cacheSize").get_to(value.cache_size);
         json.at("enableWebsocket").get_to(value.enable_websocket);
     }
+
+    void read_json(utils::JsonReader& reader, SessionConfig& value)
+    {
+        reader.read_object({ "cacheSize", "enableWebsocket" }, [&](const std::string_view key)
+        {
+            if (key == "cacheSize") read_json(reader, value.cache_size);
+            else if (key == "enableWebsocket") read_json(reader, value.enable_websocket);
+            else reader.skip();
+        });
+    }
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../utils/json_extensions.h"
+#include "../utils/json_reader.h"
+#include "../utils/json_writer.h"
 #include "../utils/adaptor.h"
 
 namespace mirai
@@ -93,6 +95,10 @@ namespace mirai
 
     /**
      * \brief Execution policy of event processing
+     * \details With single_thread the events of a connection are handled one at a
+     * time on the WebSocket I/O threads, which still serve other connections in
+     * parallel if there are more than one of them. With thread_pool the events are
+     * posted to the thread pool of the session.
      */
     enum class ExecutionPolicy { single_thread, thread_pool };
 
@@ -194,17 +200,31 @@ namespace mirai
     inline void from_json(const utils::json& json, gid_t& value) { json.get_to(value.id); }
     inline void to_json(utils::json& json, const msgid_t value) { json = value.id; }
     inline void from_json(const utils::json& json, msgid_t& value) { json.get_to(value.id); }
+    inline void read_json(utils::JsonReader& reader, uid_t& value) { value.id = reader.read_int(); }
+    inline void read_json(utils::JsonReader& reader, gid_t& value) { value.id = reader.read_int(); }
+    inline void read_json(utils::JsonReader& reader, msgid_t& value) { value.id = static_cast<int32_t>(reader.read_int()); }
+    inline void write_json(utils::JsonWriter& writer, const uid_t value) { writer.write_int(value.id); }
+    inline void write_json(utils::JsonWriter& writer, const gid_t value) { writer.write_int(value.id); }
+    inline void write_json(utils::JsonWriter& writer, const msgid_t value) { writer.write_int(value.id); }
 
     void from_json(const utils::json& json, Group& value);
     void from_json(const utils::json& json, Member& value);
     void from_json(const utils::json& json, Friend& value);
+    void read_json(utils::JsonReader& reader, Permission& value);
+    void read_json(utils::JsonReader& reader, Group& value);
+    void read_json(utils::JsonReader& reader, Member& value);
+    void read_json(utils::JsonReader& reader, Friend& value);
 
     void to_json(utils::json& json, const GroupConfig& value);
     void from_json(const utils::json& json, GroupConfig& value);
+    void read_json(utils::JsonReader& reader, GroupConfig& value);
+    void write_json(utils::JsonWriter& writer, const GroupConfig& value);
     void to_json(utils::json& json, const MemberInfo& value);
     void from_json(const utils::json& json, MemberInfo& value);
+    void read_json(utils::JsonReader& reader, MemberInfo& value);
     void to_json(utils::json& json, const SessionConfig& value);
     void from_json(const utils::json& json, SessionConfig& value);
+    void read_json(utils::JsonReader& reader, SessionConfig& value);
 }
 
 // Provides hash function for using uid_t etc. as hash map key
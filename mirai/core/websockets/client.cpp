@@ -1,25 +1,35 @@
 #include "client.h"
+#include <algorithm>
 #include "../common.h"
 
 namespace mirai::ws
 {
-    Client::Client()
+    Client::Client(const ClientOptions& options): options_(options)
     {
+#ifndef MIRAIPP_WEBSOCKET_DEFLATE
+        if (options.compression)
+            throw RuntimeError("permessage-deflate is not supported, build with MIRAIPP_WEBSOCKET_DEFLATE");
+#endif
+        const size_t io_threads = options.io_threads != 0 ? options.io_threads :
+            std::max(std::thread::hardware_concurrency(), 1u);
         client_.clear_access_channels(wspp::log::alevel::all);
         client_.clear_error_channels(wspp::log::alevel::all);
         client_.init_asio();
         client_.start_perpetual();
-        thread_ = utils::Thread([&client = client_]()
-        {
-            try { client.run(); }
-            catch (...) { error_logger(); }
-        });
+        threads_.reserve(io_threads);
+        for (size_t i = 0; i < io_threads; i++)
+            threads_.emplace_back([&client = client_]()
+            {
+                try { client.run(); }
+                catch (...) { error_logger(); }
+            });
+        if (options.ping_interval.count() > 0) schedule_ping();
     }
 
     Client::~Client() noexcept
     {
         client_.stop_perpetual();
-        for (const auto& connection : connections_)
+        for (const auto& connection : connections())
         {
             try
             {
@@ -29,32 +39,140 @@ namespace mirai::ws
             catch (...) {}
         }
         client_.stop();
+        threads_.clear(); // Join the threads before the client is destroyed
     }
 
-    Connection& Client::connect(const std::string& uri)
+    void Client::open(const std::shared_ptr<Connection>& connection)
     {
         std::error_code error;
-        const auto ptr = client_.get_connection(uri, error);
+        const auto ptr = client_.get_connection(connection->uri(), error);
         if (error) throw RuntimeError(error.message());
-        auto& connection = *connections_.emplace_back(
-            std::make_unique<Connection>(ptr->get_handle(), uri));
+        connection->rebind(ptr->get_handle());
+        if (options_.compression) ptr->replace_header("Sec-WebSocket-Extensions", "permessage-deflate");
         using Handle = wspp::connection_hdl;
-        ptr->set_open_handler([&](const Handle hdl) { connection.on_open(client_, hdl); });
-        ptr->set_fail_handler([&](const Handle hdl) { connection.on_fail(client_, hdl); });
-        ptr->set_close_handler([&](const Handle hdl) { connection.on_close(client_, hdl); });
-        ptr->set_message_handler([&](const Handle hdl, const AsioClient::message_ptr msg)
+        ptr->set_open_handler([this, connection](const Handle hdl)
         {
-            connection.on_message(hdl, msg);
+            bool reopened;
+            {
+                // A connection cannot be closed while connecting, close() leaves it to this handler
+                std::lock_guard lock(mutex_);
+                if (connection->close_requested())
+                {
+                    std::error_code error;
+                    client_.close(hdl, wspp::close::status::going_away, {}, error);
+                    return;
+                }
+                // The attempts are reset when the connection opens
+                reopened = connection->reconnect_attempts() != 0;
+                connection->on_open(client_, hdl);
+            }
+            if (!reopened) return;
+            // The messages of the new connection wait on the strand until the callback returns
+            try { connection->on_reconnect(); }
+            catch (...) { error_logger(); }
+        });
+        ptr->set_fail_handler([this, connection](const Handle hdl)
+        {
+            connection->on_fail(client_, hdl);
+            on_drop(connection);
+        });
+        ptr->set_close_handler([this, connection](const Handle hdl)
+        {
+            connection->on_close(client_, hdl);
+            on_drop(connection);
+        });
+        ptr->set_pong_handler([connection](Handle, std::string) { connection->on_pong(); });
+        ptr->set_message_handler([connection](const Handle hdl, const AsioClient::message_ptr msg)
+        {
+            connection->on_message(hdl, msg);
         });
         client_.connect(ptr);
-        return connection;
+    }
+
+    void Client::on_drop(const std::shared_ptr<Connection>& connection)
+    {
+        std::lock_guard lock(mutex_);
+        const utils::ReconnectPolicy& policy = options_.reconnect;
+        if (connection->close_requested() || connection->reconnect_attempts() >= policy.max_attempts) return;
+        const auto delay = utils::backoff_delay(policy, connection->on_reconnecting());
+        client_.set_timer(long(delay.count()), [this, connection](const std::error_code& error)
+        {
+            if (error) return; // The client is stopping
+            std::lock_guard timer_lock(mutex_);
+            if (connection->close_requested()) return;
+            try { open(connection); }
+            catch (...)
+            {
+                connection->on_close(std::make_error_code(std::errc::connection_aborted));
+                error_logger();
+            }
+        });
+    }
+
+    void Client::schedule_ping()
+    {
+        client_.set_timer(long(options_.ping_interval.count()), [this](const std::error_code& error)
+        {
+            if (error) return; // The client is stopping
+            {
+                std::lock_guard lock(mutex_);
+                for (const auto& connection : connections_)
+                {
+                    if (connection->status() != Status::open) continue;
+                    std::error_code ping_error;
+                    connection->on_ping();
+                    client_.ping(connection->handle(), {}, ping_error);
+                }
+            }
+            schedule_ping();
+        });
+    }
+
+    Connection& Client::connect(const std::string& uri)
+    {
+        std::lock_guard lock(mutex_);
+        const auto& connection = connections_.emplace_back(std::make_shared<Connection>(wspp::connection_hdl(), uri));
+        try { open(connection); }
+        catch (...)
+        {
+            connections_.pop_back();
+            throw;
+        }
+        return *connection;
     }
 
     void Client::close(Connection& connection)
     {
+        std::lock_guard lock(mutex_);
+        connection.request_close();
+        switch (connection.status())
+        {
+            case Status::reconnecting:
+                // Waiting for the backoff, there is no underlying connection to close
+                connection.on_close();
+                return;
+            case Status::connecting:
+                // The open handler closes the connection once it opens, a failure ends it anyway
+                return;
+            default: break;
+        }
         std::error_code error;
         client_.close(connection.handle(),
             wspp::close::status::going_away, {}, error);
         if (error) throw RuntimeError(error.message());
     }
+
+    void Client::release(Connection& connection)
+    {
+        std::lock_guard lock(mutex_);
+        const auto iter = std::find_if(connections_.begin(), connections_.end(),
+            [&](const std::shared_ptr<Connection>& ptr) { return ptr.get() == &connection; });
+        if (iter != connections_.end()) connections_.erase(iter);
+    }
+
+    std::vector<std::shared_ptr<Connection>> Client::connections() const
+    {
+        std::lock_guard lock(mutex_);
+        return connections_;
+    }
 }
@@ -1,30 +1,63 @@
 #pragma once
 
+#include <mutex>
 #include "connection.h"
 #include "../../utils/thread.h"
+#include "../../utils/retry.h"
 
 namespace mirai::ws
 {
     namespace wspp = websocketpp;
+
+    /**
+     * \brief Options of a WebSocket client
+     */
+    struct ClientOptions final
+    {
+        size_t io_threads = 1; ///< Amount of threads running the I/O of the connections, 0 for the hardware concurrency
+        utils::ReconnectPolicy reconnect; ///< Policy of reestablishing dropped connections
+        std::chrono::milliseconds ping_interval{ 0 }; ///< Interval of pinging the open connections to measure the round-trip time, 0 to disable pinging
+        bool compression = false; ///< Offer permessage-deflate to the server, needs the library built with MIRAIPP_WEBSOCKET_DEFLATE
+    };
     
     /**
      * \brief WebSocket client
+     * \details The I/O of all the connections is run on a fixed set of threads.
+     * Handlers of a single connection are serialized by the strand that the
+     * underlying ASIO transport keeps for each connection, so the message
+     * callback of a connection is never invoked concurrently, while different
+     * connections are served in parallel when there is more than one thread. <br>
+     * Connections that drop without being closed by the user are reestablished
+     * to the same URI according to the reconnection policy, keeping the same
+     * Connection object and thus the same callbacks. <br>
+     * The handlers of the underlying connections share the ownership of the
+     * Connection objects, so a connection released from the client stays alive
+     * until its underlying connection is done with it.
      */
     class Client final
     {
     private:
-        utils::Thread thread_;
         AsioClient client_;
-        std::vector<std::unique_ptr<Connection>> connections_;
+        ClientOptions options_;
+        mutable std::mutex mutex_; // Guards the handles of the connections against reconnecting and closing
+        std::vector<utils::Thread> threads_;
+        std::vector<std::shared_ptr<Connection>> connections_; // Guarded by mutex_
+
+        void open(const std::shared_ptr<Connection>& connection);
+        void on_drop(const std::shared_ptr<Connection>& connection);
+        void schedule_ping();
     public:
         /**
-         * \brief Start a WebSocket client on another thread
+         * \brief Start a WebSocket client on other threads
+         * \param options The options of the client
+         * \remarks Enabling compression without the library built with the
+         * MIRAIPP_WEBSOCKET_DEFLATE option is reported by throwing RuntimeError
          */
-        Client();
+        explicit Client(const ClientOptions& options = {});
 
         /**
          * \brief Close all outstanding connections opened by this client,
-         * close this client, and join the thread
+         * close this client, and join the threads
          */
         ~Client() noexcept;
 
@@ -34,9 +67,10 @@ namespace mirai::ws
         Client(const Client&) = delete;
 
         /**
-         * \brief Construct a client from a temporary client object
+         * \brief Clients cannot be moved
+         * \remarks The handlers of the connections refer to the client
          */
-        Client(Client&&) noexcept = default;
+        Client(Client&&) = delete;
 
         /**
          * \brief Clients cannot be copied
@@ -44,7 +78,7 @@ namespace mirai::ws
         Client& operator=(const Client&) = delete;
 
         /**
-         * \brief Clients cannot be move assigned to
+         * \brief Clients cannot be moved
          * \remarks The underlying ASIO client forbids move assignment
          */
         Client& operator=(Client&&) = delete;
@@ -57,15 +91,37 @@ namespace mirai::ws
         Connection& connect(const std::string& uri);
 
         /**
-         * \brief Close a connection opened by this client
+         * \brief Close a connection opened by this client, the connection
+         * will not be reestablished
          * \param connection The connection to close
          */
         void close(Connection& connection);
 
         /**
-         * \brief Get all the connections started by this client
-         * \return The connections
+         * \brief Remove a connection from the connections of this client, so that
+         * the connections closed by long-running users do not pile up
+         * \param connection The connection, it must not be used afterwards
+         * \remarks Releasing a connection does not close it, the connection object
+         * is destroyed once the client is done with the underlying connection
+         */
+        void release(Connection& connection);
+
+        /**
+         * \brief Get the amount of threads running the I/O of the connections
+         * \return The amount
+         */
+        size_t io_threads() const { return threads_.size(); }
+
+        /**
+         * \brief Get the options of this client
+         * \return The options
+         */
+        const ClientOptions& options() const { return options_; }
+
+        /**
+         * \brief Get all the connections started by this client and not released
+         * \return A snapshot of the connections
          */
-        const auto& connections() const { return connections_; }
+        std::vector<std::shared_ptr<Connection>> connections() const;
     };
 }
@@ -1,4 +1,5 @@
 #include "connection.h"
+#include <utility>
 
 namespace mirai::ws
 {
@@ -10,44 +11,190 @@ namespace mirai::ws
             case Status::open: return "open";
             case Status::failed: return "failed";
             case Status::closed: return "closed";
+            case Status::reconnecting: return "reconnecting";
             default: return "unknown";
         }
     }
 
+    namespace
+    {
+        int64_t now()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        // The connection whose callbacks are being invoked on this thread, with the depth
+        // of the nested invocations, e.g. backfilled messages from the reconnect callback
+        struct Invoking
+        {
+            const Connection* connection = nullptr;
+            size_t depth = 0;
+        };
+
+        thread_local Invoking invoking;
+    }
+
+    // Counts an invocation of the callbacks for detach() to wait for
+    class Connection::CallbackScope final
+    {
+    private:
+        Connection& connection_;
+        Invoking previous_;
+    public:
+        explicit CallbackScope(Connection& connection): connection_(connection), previous_(invoking)
+        {
+            connection_.callbacks_in_flight_.fetch_add(1);
+            invoking = { &connection, previous_.connection == &connection ? previous_.depth + 1 : 1 };
+        }
+
+        ~CallbackScope() noexcept
+        {
+            invoking = previous_;
+            connection_.callbacks_in_flight_.fetch_sub(1);
+            // Only a detaching connection has a waiter to notify
+            if (!connection_.detaching_.load()) return;
+            std::lock_guard lock(connection_.detach_mutex_);
+            connection_.callbacks_done_.notify_all();
+        }
+
+        CallbackScope(const CallbackScope&) = delete;
+        CallbackScope& operator=(const CallbackScope&) = delete;
+    };
+
+    void Connection::set_state(const Status status, const std::error_code error)
+    {
+        std::atomic_store(&error_, error ? std::make_shared<const std::error_code>(error) : nullptr);
+        status_.store(status, std::memory_order_release);
+    }
+
+    void Connection::set_server(std::string server)
+    {
+        std::atomic_store(&server_, std::make_shared<const std::string>(std::move(server)));
+    }
+
     // NOLINTNEXTLINE(performance-unnecessary-value-param)
     void Connection::on_open(AsioClient& client, const Handle& handle)
     {
-        status_ = Status::open;
         const auto ptr = client.get_con_from_hdl(handle);
-        server_ = ptr->get_response_header("Server");
+        set_server(ptr->get_response_header("Server"));
+        reconnect_attempts_.store(0);
+        set_state(Status::open);
     }
 
     // NOLINTNEXTLINE(performance-unnecessary-value-param)
     void Connection::on_fail(AsioClient& client, const Handle& handle)
     {
-        status_ = Status::failed;
         const auto ptr = client.get_con_from_hdl(handle);
-        server_ = ptr->get_response_header("Server");
-        error_ = ptr->get_ec();
+        set_server(ptr->get_response_header("Server"));
+        set_state(Status::failed, ptr->get_ec());
     }
 
     // NOLINTNEXTLINE(performance-unnecessary-value-param)
     void Connection::on_close(AsioClient& client, const Handle& handle)
     {
-        status_ = Status::closed;
         const auto ptr = client.get_con_from_hdl(handle);
-        error_ = ptr->get_ec();
+        set_state(Status::closed, ptr->get_ec());
+    }
+
+    void Connection::on_open(const std::string_view server)
+    {
+        set_server(std::string(server));
+        set_state(Status::open);
+    }
+
+    void Connection::on_close(const std::error_code error) { set_state(Status::closed, error); }
+
+    size_t Connection::on_reconnecting()
+    {
+        status_.store(Status::reconnecting, std::memory_order_release);
+        return reconnect_attempts_.fetch_add(1);
+    }
+
+    void Connection::on_reconnect()
+    {
+        reconnects_.fetch_add(1, std::memory_order_relaxed);
+        CallbackScope scope(*this);
+        if (const auto callback = std::atomic_load(&reconnect_callback_)) (*callback)();
+    }
+
+    void Connection::rebind(Handle handle)
+    {
+        std::atomic_store(&handle_, std::make_shared<const Handle>(std::move(handle)));
+        status_.store(Status::connecting, std::memory_order_release);
+    }
+
+    void Connection::on_ping() noexcept { ping_time_.store(now(), std::memory_order_relaxed); }
+
+    void Connection::on_pong() noexcept
+    {
+        const int64_t sent = ping_time_.exchange(0, std::memory_order_relaxed);
+        if (sent != 0) ping_rtt_.store((now() - sent) / 1000, std::memory_order_relaxed);
     }
 
     // NOLINTNEXTLINE(performance-unnecessary-value-param)
-    void Connection::on_message(const Handle&, const AsioClient::message_ptr& message) const
+    void Connection::on_message(const Handle&, const AsioClient::message_ptr& message)
+    {
+        const size_t size = message->get_payload().size();
+        frames_received_.fetch_add(1, std::memory_order_relaxed);
+        bytes_received_.fetch_add(size, std::memory_order_relaxed);
+        if (message->get_compressed())
+        {
+            // The last frame of the message has just been inflated on this thread, messages
+            // fed by transports that do not inflate them have no compressed size to count
+            compressed_frames_.fetch_add(1, std::memory_order_relaxed);
+            if (uint64_t* const input = std::exchange(detail::compressed_input(), nullptr))
+                compressed_bytes_.fetch_add(std::exchange(*input, 0), std::memory_order_relaxed);
+            inflated_bytes_.fetch_add(size, std::memory_order_relaxed);
+        }
+        last_frame_time_.store(now(), std::memory_order_relaxed);
+        CallbackScope scope(*this);
+        if (const auto callback = std::atomic_load(&message_callback_)) (*callback)(message);
+    }
+
+    void Connection::message_callback(MessageCallback callback)
+    {
+        std::atomic_store(&message_callback_,
+            callback ? std::make_shared<const MessageCallback>(std::move(callback)) : nullptr);
+    }
+
+    void Connection::reconnect_callback(std::function<void()> callback)
+    {
+        std::atomic_store(&reconnect_callback_,
+            callback ? std::make_shared<const std::function<void()>>(std::move(callback)) : nullptr);
+    }
+
+    void Connection::detach()
     {
-        if (!message_callback_) return;
-        message_callback_(message);
+        // An invocation either finds the callbacks removed or is counted before the wait below
+        detaching_.store(true);
+        std::atomic_store(&message_callback_, std::shared_ptr<const MessageCallback>());
+        std::atomic_store(&reconnect_callback_, std::shared_ptr<const std::function<void()>>());
+        // Detaching from the callbacks does not wait for the invocations calling it
+        const size_t own = invoking.connection == this ? invoking.depth : 0;
+        std::unique_lock lock(detach_mutex_);
+        callbacks_done_.wait(lock, [&] { return callbacks_in_flight_.load() == own; });
     }
 
-    void Connection::message_callback(std::function<void(const AsioClient::message_ptr&)> callback)
+    ConnectionStats Connection::stats() const noexcept
     {
-        message_callback_ = std::move(callback);
+        ConnectionStats stats;
+        stats.status = status();
+        stats.frames_received = frames_received_.load(std::memory_order_relaxed);
+        stats.bytes_received = bytes_received_.load(std::memory_order_relaxed);
+        stats.filtered_frames = filtered_frames();
+        stats.reconnects = reconnects();
+        stats.queued_frames = queue_counters_->depth.load(std::memory_order_relaxed);
+        stats.spilled_frames = queue_counters_->spilled.load(std::memory_order_relaxed);
+        stats.dropped_frames = queue_counters_->dropped.load(std::memory_order_relaxed);
+        stats.compressed_frames = compressed_frames_.load(std::memory_order_relaxed);
+        stats.compressed_bytes = compressed_bytes_.load(std::memory_order_relaxed);
+        stats.inflated_bytes = inflated_bytes_.load(std::memory_order_relaxed);
+        if (const int64_t time = last_frame_time_.load(std::memory_order_relaxed); time != 0)
+            stats.last_frame_time = Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+                std::chrono::nanoseconds(time)));
+        if (const int64_t rtt = ping_rtt_.load(std::memory_order_relaxed); rtt >= 0)
+            stats.ping_rtt = std::chrono::microseconds(rtt);
+        return stats;
     }
 }
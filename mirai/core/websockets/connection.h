@@ -14,6 +14,9 @@
 #include <websocketpp/connection.hpp>
 #include <websocketpp/client.hpp>
 #include <websocketpp/config/asio_no_tls_client.hpp>
+#ifdef MIRAIPP_WEBSOCKET_DEFLATE
+#   include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
 
 #ifdef WIN32
 #   ifdef near
@@ -27,6 +30,12 @@
 #endif
 
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
 
 namespace mirai::ws
 {
@@ -35,7 +44,7 @@ namespace mirai::ws
     /**
      * \brief Status of a WebSocket connection
      */
-    enum class Status { connecting, open, failed, closed };
+    enum class Status { connecting, open, failed, closed, reconnecting };
 
     /**
      * \brief Get a string representation of the status
@@ -44,22 +53,146 @@ namespace mirai::ws
      */
     const char* to_string(Status e);
 
+    namespace detail
+    {
+        // Compressed payload size of the message being read by the connection whose frame has
+        // just been inflated on this thread. A message is handed to the message handler on the
+        // thread that inflated its last frame, before any other frame is read on the thread
+        inline uint64_t*& compressed_input()
+        {
+            thread_local uint64_t* bytes = nullptr;
+            return bytes;
+        }
+
+#ifdef MIRAIPP_WEBSOCKET_DEFLATE
+        // The permessage-deflate extension, except that the offer is made per connection
+        // by the client instead of for every connection, and that the compressed sizes
+        // are recorded for the statistics of the connections. Each connection has its
+        // own instance, the frames of a message may be inflated on different threads
+        template <typename Config>
+        class Deflate final : public wspp::extensions::permessage_deflate::enabled<Config>
+        {
+        private:
+            using Base = wspp::extensions::permessage_deflate::enabled<Config>;
+            uint64_t message_input_ = 0; // Taken by the message handler through compressed_input()
+        public:
+            std::string generate_offer() const { return {}; }
+
+            wspp::lib::error_code decompress(const uint8_t* buf, const size_t len, std::string& out)
+            {
+                message_input_ += len;
+                compressed_input() = &message_input_;
+                return Base::decompress(buf, len, out);
+            }
+        };
+
+        struct DeflateClientConfig : wspp::config::asio_client
+        {
+            using type = DeflateClientConfig;
+            struct permessage_deflate_config {};
+            using permessage_deflate_type = Deflate<permessage_deflate_config>;
+        };
+#endif
+    }
+
+#ifdef MIRAIPP_WEBSOCKET_DEFLATE
+    using AsioClient = wspp::client<detail::DeflateClientConfig>;
+#else
     using AsioClient = wspp::client<wspp::config::asio_client>;
+#endif
+
+    /**
+     * \brief Counters of the frames of a connection waiting to be handled, shared
+     * between the connection and the queue feeding the frames to the handlers
+     */
+    struct QueueCounters final
+    {
+        std::atomic<size_t> depth{ 0 }; ///< Amount of frames queued in memory
+        std::atomic<size_t> spilled{ 0 }; ///< Amount of frames currently in the spill file
+        std::atomic<uint64_t> dropped{ 0 }; ///< Total amount of frames dropped because the queue is full
+        std::atomic<uint64_t> spilled_total{ 0 }; ///< Total amount of frames written to the spill file
+    };
+
+    /**
+     * \brief A snapshot of the state and the counters of a WebSocket connection
+     */
+    struct ConnectionStats final
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Status status = Status::connecting; ///< Status of the connection
+        uint64_t frames_received = 0; ///< Amount of frames received, including the filtered ones
+        uint64_t bytes_received = 0; ///< Total payload size of the frames received
+        uint64_t filtered_frames = 0; ///< Amount of frames dropped by the message callback without being decoded
+        uint64_t reconnects = 0; ///< Amount of times the connection has been reopened
+        size_t queued_frames = 0; ///< Amount of frames queued in memory waiting for the handlers
+        size_t spilled_frames = 0; ///< Amount of frames in the spill file waiting for the handlers
+        uint64_t dropped_frames = 0; ///< Amount of frames dropped because the queue is full
+        uint64_t compressed_frames = 0; ///< Amount of frames received compressed by permessage-deflate
+        uint64_t compressed_bytes = 0; ///< Payload size of the compressed frames as received
+        uint64_t inflated_bytes = 0; ///< Payload size of the compressed frames after decompression
+        std::optional<Clock::time_point> last_frame_time; ///< Time when the last frame is received, if any
+        std::optional<std::chrono::microseconds> ping_rtt; ///< Round-trip time of the last ping answered, if any
+
+        /**
+         * \brief Get the compression ratio of the compressed frames
+         * \return The size after decompression divided by the size received, 0 if no
+         * frame is compressed
+         */
+        double compression_ratio() const
+        {
+            return compressed_bytes == 0 ? 0.0 : double(inflated_bytes) / double(compressed_bytes);
+        }
+    };
 
     /**
      * \brief A WebSocket connection
+     * \details The state and the counters of the connection are atomics updated
+     * by the I/O threads, thus they can be read on any thread without locking.
      * \remarks Connections are only supposed to be constructed on the heap
      */
     class Connection final
     {
+    public:
+        using MessageCallback = std::function<void(const AsioClient::message_ptr&)>;
+
     private:
         using Handle = wspp::connection_hdl;
-        Handle handle_;
-        Status status_ = Status::connecting;
-        std::error_code error_{};
+        using Clock = ConnectionStats::Clock;
+        // Accessed by std::atomic_load and std::atomic_store, rebind() replaces it on the I/O threads
+        std::shared_ptr<const Handle> handle_;
+        std::atomic<Status> status_{ Status::connecting };
+        // Accessed by std::atomic_load and std::atomic_store, null for no error. The error is
+        // stored before the status, so it is consistent with the status read before it
+        std::shared_ptr<const std::error_code> error_;
         std::string uri_;
-        std::string server_ = "N/A";
-        std::function<void(const AsioClient::message_ptr&)> message_callback_{};
+        std::shared_ptr<const std::string> server_; // Accessed by std::atomic_load and std::atomic_store
+        // The callbacks are accessed by std::atomic_load and std::atomic_store, invocations
+        // are counted so that detach() can wait for them
+        std::shared_ptr<const MessageCallback> message_callback_;
+        std::shared_ptr<const std::function<void()>> reconnect_callback_;
+        std::atomic<size_t> callbacks_in_flight_{ 0 };
+        std::atomic<bool> detaching_{ false };
+        std::mutex detach_mutex_;
+        std::condition_variable callbacks_done_;
+        std::atomic<size_t> reconnect_attempts_{ 0 };
+        std::atomic<bool> close_requested_{ false };
+        std::atomic<uint64_t> frames_received_{ 0 };
+        std::atomic<uint64_t> bytes_received_{ 0 };
+        std::atomic<uint64_t> filtered_frames_{ 0 };
+        std::atomic<uint64_t> reconnects_{ 0 };
+        std::atomic<uint64_t> compressed_frames_{ 0 };
+        std::atomic<uint64_t> compressed_bytes_{ 0 };
+        std::atomic<uint64_t> inflated_bytes_{ 0 };
+        std::shared_ptr<QueueCounters> queue_counters_ = std::make_shared<QueueCounters>();
+        std::atomic<int64_t> last_frame_time_{ 0 }; // Nanoseconds since the clock epoch, 0 for no frame
+        std::atomic<int64_t> ping_time_{ 0 }; // Nanoseconds since the clock epoch, 0 for no ping in flight
+        std::atomic<int64_t> ping_rtt_{ -1 }; // Microseconds, -1 for no pong received
+
+        class CallbackScope;
+
+        void set_state(Status status, std::error_code error = {});
+        void set_server(std::string server);
     public:
         /**
          * \brief Construct a connection object using a handle and an URI
@@ -67,7 +200,7 @@ namespace mirai::ws
          * \param uri The URI
          */
         Connection(Handle handle, const std::string_view uri) :
-            handle_(std::move(handle)), uri_(uri) {}
+            handle_(std::make_shared<const Handle>(std::move(handle))), uri_(uri), server_(std::make_shared<const std::string>("N/A")) {}
 
         /**
          * \brief Destroy a connection object
@@ -116,41 +249,105 @@ namespace mirai::ws
          */
         void on_close(AsioClient& client, const Handle& handle);
 
+        /**
+         * \brief Mark the connection as open, used by transports that
+         * are not backed by a WebSocket client
+         * \param server A string describing the server
+         */
+        void on_open(std::string_view server);
+
+        /**
+         * \brief Mark the connection as closed, used by transports that
+         * are not backed by a WebSocket client
+         * \param error The error code if an error occurred
+         */
+        void on_close(std::error_code error = {});
+
+        /**
+         * \brief This function is called when the client starts waiting to reconnect
+         * after the connection has dropped
+         * \return Zero-based index of this reconnection attempt
+         */
+        size_t on_reconnecting();
+
+        /**
+         * \brief This function is called when the connection is reopened after
+         * having dropped, it invokes the reconnect callback
+         */
+        void on_reconnect();
+
+        /**
+         * \brief Replace the handle by the one of a new underlying connection
+         * \param handle The new connection handle
+         */
+        void rebind(Handle handle);
+
+        /**
+         * \brief Mark that the connection is being closed by the user, so that
+         * it is not reconnected after closing
+         */
+        void request_close() { close_requested_.store(true); }
+
+        /**
+         * \brief Check whether the connection is being closed by the user
+         * \return The result
+         */
+        bool close_requested() const { return close_requested_.load(); }
+
+        /**
+         * \brief This function is called when a ping is sent through the connection
+         */
+        void on_ping() noexcept;
+
+        /**
+         * \brief This function is called when the connection receives a pong,
+         * the round-trip time of the last ping is measured
+         */
+        void on_pong() noexcept;
+
         /**
          * \brief This function is called when the connection receives a message
          * \param message The message
          */
-        void on_message(const Handle&, const AsioClient::message_ptr& message) const;
+        void on_message(const Handle&, const AsioClient::message_ptr& message);
 
         /**
          * \brief Get the connection handle assiociated to this connection
          * \return The handle
          */
-        Handle handle() const { return handle_; }
+        Handle handle() const { return *std::atomic_load(&handle_); }
 
         /**
          * \brief Get the current status of this connection
          * \return The status
          */
-        Status status() const { return status_; }
+        Status status() const { return status_.load(std::memory_order_acquire); }
 
         /**
          * \brief Check whether the connection is ended
          * \return The result
          */
-        bool ended() const { return status_ == Status::failed || status_ == Status::closed; }
+        bool ended() const
+        {
+            const Status status = this->status();
+            return status == Status::failed || status == Status::closed;
+        }
 
         /**
          * \brief Get the error code of the connection if an error occurred
          * \return The error code
          */
-        std::error_code error() const { return error_; }
+        std::error_code error() const
+        {
+            const auto error = std::atomic_load(&error_);
+            return error ? *error : std::error_code{};
+        }
 
         /**
          * \brief Get the error reason of the connection if an error occurred
          * \return The error reason
          */
-        std::string error_reason() const { return error_.message(); }
+        std::string error_reason() const { return error().message(); }
 
         /**
          * \brief Get the URI this connection is connected to
@@ -162,18 +359,75 @@ namespace mirai::ws
          * \brief Get a string describing the server
          * \return The string
          */
-        const std::string& server() const { return server_; }
+        std::string server() const { return *std::atomic_load(&server_); }
 
         /**
          * \brief Set the message callback of this connection
          * \param callback The callback to set
          */
-        void message_callback(std::function<void(const AsioClient::message_ptr&)> callback);
+        void message_callback(MessageCallback callback);
 
         /**
          * \brief Get the message callback of this connection
-         * \return The callback
+         * \return The callback, null if there is none
+         */
+        std::shared_ptr<const MessageCallback> message_callback() const { return std::atomic_load(&message_callback_); }
+
+        /**
+         * \brief Set the callback invoked after the connection is reopened by
+         * the client, before the messages received on the new connection
+         * \param callback The callback to set
+         */
+        void reconnect_callback(std::function<void()> callback);
+
+        /**
+         * \brief Remove the callbacks of the connection, and wait for the ongoing
+         * invocations of them to return
+         * \details The state captured by the callbacks is released once this function
+         * returns, even if the connection object is kept by the client afterwards.
+         * When called from a callback of this connection, the invocations calling
+         * this function are not waited for, and the callback keeps its own state
+         * alive until it returns.
+         */
+        void detach();
+
+        /**
+         * \brief Get the amount of consecutive failed reconnection attempts
+         * \return The amount
+         */
+        size_t reconnect_attempts() const { return reconnect_attempts_.load(); }
+
+        /**
+         * \brief Get the amount of times the connection has been reopened
+         * \return The amount
+         */
+        uint64_t reconnects() const noexcept { return reconnects_.load(std::memory_order_relaxed); }
+
+        /**
+         * \brief Count a frame dropped by the message callback without being decoded,
+         * e.g. an event of a type not subscribed to
+         */
+        void count_filtered_frame() noexcept { filtered_frames_.fetch_add(1, std::memory_order_relaxed); }
+
+        /**
+         * \brief Get the amount of frames dropped by the message callback without
+         * being decoded
+         * \return The amount
+         */
+        uint64_t filtered_frames() const noexcept { return filtered_frames_.load(std::memory_order_relaxed); }
+
+        /**
+         * \brief Get the counters of the frames waiting to be handled
+         * \return The counters, shared with the queue updating them
+         */
+        const std::shared_ptr<QueueCounters>& queue_counters() const noexcept { return queue_counters_; }
+
+        /**
+         * \brief Get a snapshot of the state and the counters of the connection
+         * \return The snapshot
+         * \remarks The fields are read one by one, so counters updated concurrently
+         * may be slightly out of step with each other
          */
-        const auto& message_callback() const { return message_callback_; }
+        ConnectionStats stats() const noexcept;
     };
 }
@@ -2,4 +2,6 @@
 
 #include "core/common.h"
 #include "core/session.h"
+#include "core/send_queue.h"
+#include "core/loopback_transport.h"
 #include "utils/encoding.h"
@@ -45,8 +45,17 @@ namespace mirai::utils
         /**
          * \brief Construct an array proxy from a brace initializer list
          * \param list The initializer list
+         * \remarks The underlying array lives until the end of the full expression,
+         * which is fine for array proxies used as function parameters
          */
-        constexpr ArrayProxy(const std::initializer_list<T> list) : data_(&*list.begin()), size_(list.size()) {}
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Winit-list-lifetime"
+#endif
+        constexpr ArrayProxy(const std::initializer_list<T> list) : data_(list.begin()), size_(list.size()) {}
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic pop
+#endif
 
         /**
          * \brief Construct an array proxy from a C++ std::array
@@ -0,0 +1,118 @@
+#include "connection_pool.h"
+#include <thread>
+#include <utility>
+#include <cpr/cpr.h>
+
+namespace mirai::utils
+{
+    struct ConnectionPool::Entry final
+    {
+        cpr::Session session;
+        std::string url_buffer;
+    };
+
+    namespace
+    {
+        size_t actual_size(const size_t max_size)
+        {
+            if (max_size != 0) return max_size;
+            const size_t concurrency = std::thread::hardware_concurrency();
+            return concurrency != 0 ? concurrency : 1;
+        }
+    }
+
+    ConnectionPool::Lease::Lease(ConnectionPool& pool, std::unique_ptr<Entry> entry) noexcept:
+        pool_(&pool), entry_(std::move(entry)) {}
+
+    ConnectionPool::Lease::Lease(Lease&& other) noexcept:
+        pool_(std::exchange(other.pool_, nullptr)), entry_(std::move(other.entry_)) {}
+
+    ConnectionPool::Lease::~Lease() noexcept
+    {
+        if (pool_ && entry_)
+            pool_->release(std::move(entry_));
+    }
+
+    cpr::Session& ConnectionPool::Lease::operator*() const { return entry_->session; }
+
+    std::string& ConnectionPool::Lease::url_buffer() const { return entry_->url_buffer; }
+
+    void ConnectionPool::release(std::unique_ptr<Entry> entry) noexcept
+    {
+        {
+            std::unique_lock lock(mutex_);
+            if (size_ > max_size_) // The pool has shrunk, drop the surplus session
+            {
+                size_--;
+                lock.unlock();
+                entry.reset();
+            }
+            else
+                idle_.emplace_back(std::move(entry));
+        }
+        cv_.notify_one();
+    }
+
+    ConnectionPool::ConnectionPool(const size_t max_size): max_size_(actual_size(max_size))
+    {
+        idle_.reserve(max_size_);
+    }
+
+    ConnectionPool::~ConnectionPool() noexcept = default;
+
+    ConnectionPool::Lease ConnectionPool::take(std::unique_lock<std::mutex>& lock)
+    {
+        if (!idle_.empty())
+        {
+            std::unique_ptr<Entry> entry = std::move(idle_.back());
+            idle_.pop_back();
+            return Lease(*this, std::move(entry));
+        }
+        size_++;
+        lock.unlock();
+        try { return Lease(*this, std::make_unique<Entry>()); }
+        catch (...)
+        {
+            lock.lock();
+            size_--;
+            cv_.notify_one();
+            throw;
+        }
+    }
+
+    ConnectionPool::Lease ConnectionPool::acquire()
+    {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return !idle_.empty() || size_ < max_size_; });
+        return take(lock);
+    }
+
+    std::optional<ConnectionPool::Lease> ConnectionPool::acquire_until(
+        const std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock lock(mutex_);
+        if (!cv_.wait_until(lock, deadline, [this] { return !idle_.empty() || size_ < max_size_; }))
+            return std::nullopt;
+        return take(lock);
+    }
+
+    size_t ConnectionPool::max_size() const
+    {
+        std::lock_guard lock(mutex_);
+        return max_size_;
+    }
+
+    void ConnectionPool::max_size(const size_t max_size)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            max_size_ = actual_size(max_size);
+            while (size_ > max_size_ && !idle_.empty())
+            {
+                idle_.pop_back();
+                size_--;
+            }
+        }
+        cv_.notify_all();
+    }
+}
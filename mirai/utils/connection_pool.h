@@ -0,0 +1,168 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <optional>
+
+namespace cpr
+{
+    class Session;
+}
+
+namespace mirai::utils
+{
+    /**
+     * \brief A thread-safe pool of reusable HTTP sessions, each session keeps its
+     * connection to the server alive between requests
+     * \remarks Sessions are created lazily. If all the sessions are in use and the
+     * size limit of the pool is reached, acquiring a session blocks until another
+     * thread releases one.
+     */
+    class ConnectionPool final
+    {
+    private:
+        struct Entry;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<std::unique_ptr<Entry>> idle_;
+        size_t max_size_ = 0;
+        size_t size_ = 0;
+
+        void release(std::unique_ptr<Entry> entry) noexcept;
+    public:
+        /**
+         * \brief An exclusive handle to a pooled session, the session is returned
+         * to the pool when the lease is destroyed
+         */
+        class Lease final
+        {
+        private:
+            ConnectionPool* pool_ = nullptr;
+            std::unique_ptr<Entry> entry_;
+        public:
+            /**
+             * \brief Construct a lease from a pool and a session taken from the pool
+             * \param pool The pool
+             * \param entry The pooled session
+             */
+            Lease(ConnectionPool& pool, std::unique_ptr<Entry> entry) noexcept;
+
+            /**
+             * \brief Return the session to the pool
+             */
+            ~Lease() noexcept;
+
+            /**
+             * \brief Leases cannot be copied
+             */
+            Lease(const Lease&) = delete;
+
+            /**
+             * \brief Take the ownership of a lease from another object
+             * \param other The other object
+             */
+            Lease(Lease&& other) noexcept;
+
+            /**
+             * \brief Leases cannot be copied
+             */
+            Lease& operator=(const Lease&) = delete;
+
+            /**
+             * \brief Leases cannot be move assigned to
+             */
+            Lease& operator=(Lease&&) = delete;
+
+            /**
+             * \brief Get the leased session
+             * \return Reference to the session
+             */
+            cpr::Session& operator*() const;
+
+            /**
+             * \brief Get the leased session
+             * \return Pointer to the session
+             */
+            cpr::Session* operator->() const { return &**this; }
+
+            /**
+             * \brief Get a string buffer kept along with the leased session
+             * \return Reference to the buffer
+             * \remarks The buffer keeps its capacity between leases, building
+             * request URLs in it avoids growing a new string for every request
+             */
+            std::string& url_buffer() const;
+        };
+
+    private:
+        Lease take(std::unique_lock<std::mutex>& lock); // Must be called with a session available
+    public:
+        /**
+         * \brief Construct a connection pool
+         * \param max_size Maximum amount of sessions alive at the same time,
+         * 0 for the hardware concurrency
+         */
+        explicit ConnectionPool(size_t max_size = 0);
+
+        /**
+         * \brief Destroy the pool and close all the idle connections
+         * \remarks All leases should be returned before destroying the pool
+         */
+        ~ConnectionPool() noexcept;
+
+        /**
+         * \brief Connection pools cannot be copied
+         */
+        ConnectionPool(const ConnectionPool&) = delete;
+
+        /**
+         * \brief Connection pools cannot be moved
+         */
+        ConnectionPool(ConnectionPool&&) = delete;
+
+        /**
+         * \brief Connection pools cannot be copied
+         */
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        /**
+         * \brief Connection pools cannot be moved
+         */
+        ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+        /**
+         * \brief Take an idle session from the pool, or create a new one if the
+         * pool is not full, block until a session is available otherwise
+         * \return The lease of the session
+         */
+        Lease acquire();
+
+        /**
+         * \brief Take an idle session from the pool, or create a new one if the
+         * pool is not full, block until a session is available or the deadline
+         * is reached otherwise
+         * \param deadline The deadline
+         * \return The lease of the session, or nullopt if the deadline is reached
+         */
+        std::optional<Lease> acquire_until(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * \brief Get the maximum amount of sessions alive at the same time
+         * \return The size limit
+         */
+        size_t max_size() const;
+
+        /**
+         * \brief Set the maximum amount of sessions alive at the same time
+         * \param max_size The new size limit, 0 for the hardware concurrency
+         * \remarks If the pool currently holds more sessions than the new limit,
+         * the surplus sessions are closed when they are returned to the pool
+         */
+        void max_size(size_t max_size);
+    };
+}
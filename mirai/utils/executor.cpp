@@ -0,0 +1,33 @@
+#include "executor.h"
+
+namespace mirai::utils
+{
+    Executor::Executor(const size_t thread_count):
+        pool_(thread_count == 0 ? std::make_shared<asio::thread_pool>() :
+            std::make_shared<asio::thread_pool>(thread_count)),
+        owns_pool_(true) {}
+
+    void Executor::finish() noexcept
+    {
+        // Notify under the lock, join() may return and the executor be destroyed once it is released
+        std::lock_guard lock(mutex_);
+        pending_--;
+        idle_.notify_all();
+    }
+
+    void Executor::join()
+    {
+        if (owns_pool_)
+        {
+            pool_->join();
+            return;
+        }
+        wait();
+    }
+
+    void Executor::wait()
+    {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this] { return pending_ == 0; });
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <asio/thread_pool.hpp>
+#include <asio/post.hpp>
+
+namespace mirai::utils
+{
+    /**
+     * \brief A handle for posting tasks to a thread pool, which is either owned by
+     * the executor or shared with other executors
+     * \details The executor counts the tasks posted through it, so that join()
+     * waits for those tasks only when the pool is shared with others.
+     */
+    class Executor final
+    {
+    private:
+        std::shared_ptr<asio::thread_pool> pool_;
+        bool owns_pool_ = false;
+        std::mutex mutex_;
+        std::condition_variable idle_;
+        size_t pending_ = 0;
+
+        void finish() noexcept;
+    public:
+        /**
+         * \brief Construct an executor owning a new thread pool
+         * \param thread_count Thread count of the pool, 0 for the default of asio
+         */
+        explicit Executor(size_t thread_count = 0);
+
+        /**
+         * \brief Construct an executor posting tasks to a shared thread pool
+         * \param pool The thread pool
+         */
+        explicit Executor(std::shared_ptr<asio::thread_pool> pool) noexcept:
+            pool_(std::move(pool)) {}
+
+        /**
+         * \brief Wait for the tasks posted through this executor and release the pool
+         */
+        ~Executor() noexcept { join(); }
+
+        /**
+         * \brief Executors cannot be copied
+         */
+        Executor(const Executor&) = delete;
+
+        /**
+         * \brief Executors cannot be moved, posted tasks refer to the executor
+         */
+        Executor(Executor&&) = delete;
+
+        /**
+         * \brief Executors cannot be copied
+         */
+        Executor& operator=(const Executor&) = delete;
+
+        /**
+         * \brief Executors cannot be moved, posted tasks refer to the executor
+         */
+        Executor& operator=(Executor&&) = delete;
+
+        /**
+         * \brief Post a task to the thread pool
+         * \tparam F Type of the task
+         * \param func The task, it should not throw
+         */
+        template <typename F>
+        void post(F&& func)
+        {
+            {
+                std::lock_guard lock(mutex_);
+                pending_++;
+            }
+            asio::post(*pool_, [this, func = std::forward<F>(func)]() mutable
+            {
+                func();
+                finish();
+            });
+        }
+
+        /**
+         * \brief Wait for all the tasks posted through this executor to complete,
+         * and join the threads if the pool is owned by this executor
+         */
+        void join();
+
+        /**
+         * \brief Wait for all the tasks posted through this executor to complete,
+         * the pool keeps running afterwards
+         */
+        void wait();
+
+        /**
+         * \brief Check whether the thread pool is shared with others
+         * \return The result
+         */
+        bool shared() const noexcept { return !owns_pool_; }
+    };
+}
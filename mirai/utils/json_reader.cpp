@@ -0,0 +1,314 @@
+#include "json_reader.h"
+#include <charconv>
+#include "../core/common.h"
+
+namespace mirai::utils
+{
+    namespace
+    {
+        bool is_whitespace(const char ch) { return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t'; }
+
+        // Whether the text starts with the literal followed by a delimiter, so that "truex" isn't true
+        bool starts_with_literal(const std::string_view text, const std::string_view literal)
+        {
+            if (text.substr(0, literal.size()) != literal) return false;
+            if (text.size() == literal.size()) return true;
+            const char next = text[literal.size()];
+            return is_whitespace(next) || next == ',' || next == ']' || next == '}';
+        }
+
+        int hex_value(const char ch)
+        {
+            if (ch >= '0' && ch <= '9') return ch - '0';
+            if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+            if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+            return -1;
+        }
+
+        void append_utf8(std::string& str, const uint32_t code_point)
+        {
+            if (code_point < 0x80)
+                str += static_cast<char>(code_point);
+            else if (code_point < 0x800)
+            {
+                str += static_cast<char>(0xc0 | (code_point >> 6));
+                str += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+            else if (code_point < 0x10000)
+            {
+                str += static_cast<char>(0xe0 | (code_point >> 12));
+                str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                str += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+            else
+            {
+                str += static_cast<char>(0xf0 | (code_point >> 18));
+                str += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+                str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                str += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+        }
+    }
+
+    JsonReader::JsonReader(const std::string_view text): text_(text) {}
+
+    char JsonReader::skip_whitespace()
+    {
+        while (pos_ < text_.size() && is_whitespace(text_[pos_])) pos_++;
+        if (pos_ == text_.size()) error("unexpected end of text");
+        return text_[pos_];
+    }
+
+    void JsonReader::expect(const char ch)
+    {
+        if (skip_whitespace() != ch) error("unexpected character");
+        pos_++;
+    }
+
+    std::string_view JsonReader::read_string_token()
+    {
+        expect('"');
+        const size_t begin = pos_;
+        // Fast path: strings without escapes are returned as views into the text
+        while (pos_ < text_.size())
+        {
+            const char ch = text_[pos_];
+            if (ch == '"') return text_.substr(begin, pos_++ - begin);
+            if (ch == '\\') break;
+            pos_++;
+        }
+        if (pos_ == text_.size()) error("unterminated string");
+        scratch_.assign(text_.data() + begin, pos_ - begin);
+        const auto read_hex4 = [this]
+        {
+            if (text_.size() - pos_ < 4) error("invalid unicode escape");
+            uint32_t value = 0;
+            for (size_t i = 0; i < 4; i++)
+            {
+                const int digit = hex_value(text_[pos_++]);
+                if (digit < 0) error("invalid unicode escape");
+                value = value << 4 | static_cast<uint32_t>(digit);
+            }
+            return value;
+        };
+        while (pos_ < text_.size())
+        {
+            const char ch = text_[pos_++];
+            if (ch == '"') return scratch_;
+            if (ch != '\\')
+            {
+                scratch_ += ch;
+                continue;
+            }
+            if (pos_ == text_.size()) break;
+            switch (text_[pos_++])
+            {
+                case '"': scratch_ += '"'; break;
+                case '\\': scratch_ += '\\'; break;
+                case '/': scratch_ += '/'; break;
+                case 'b': scratch_ += '\b'; break;
+                case 'f': scratch_ += '\f'; break;
+                case 'n': scratch_ += '\n'; break;
+                case 'r': scratch_ += '\r'; break;
+                case 't': scratch_ += '\t'; break;
+                case 'u':
+                {
+                    uint32_t code_point = read_hex4();
+                    if (code_point >= 0xd800 && code_point < 0xdc00) // High surrogate
+                    {
+                        if (text_.substr(pos_, 2) != "\\u") error("invalid surrogate pair");
+                        pos_ += 2;
+                        const uint32_t low = read_hex4();
+                        if (low < 0xdc00 || low >= 0xe000) error("invalid surrogate pair");
+                        code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    append_utf8(scratch_, code_point);
+                    break;
+                }
+                default: error("invalid escape sequence");
+            }
+        }
+        error("unterminated string");
+    }
+
+    std::string_view JsonReader::read_number_token()
+    {
+        skip_whitespace();
+        const size_t begin = pos_;
+        while (pos_ < text_.size())
+        {
+            const char ch = text_[pos_];
+            if ((ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E')
+                pos_++;
+            else
+                break;
+        }
+        if (pos_ == begin) error("expected a number");
+        return text_.substr(begin, pos_ - begin);
+    }
+
+    void JsonReader::error(const char* what) const
+    {
+        throw RuntimeError("JSON parse error at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    JsonReader::Kind JsonReader::peek()
+    {
+        switch (skip_whitespace())
+        {
+            case 'n': return Kind::null;
+            case 't': case 'f': return Kind::boolean;
+            case '"': return Kind::string;
+            case '[': return Kind::array;
+            case '{': return Kind::object;
+            default: return Kind::number;
+        }
+    }
+
+    void JsonReader::begin_object()
+    {
+        expect('{');
+        first_ = true;
+    }
+
+    bool JsonReader::next_key(std::string_view& key)
+    {
+        char ch = skip_whitespace();
+        if (ch == '}')
+        {
+            pos_++;
+            first_ = false; // The parent container is never at its beginning
+            return false;
+        }
+        if (!first_)
+        {
+            if (ch != ',') error("expected ',' or '}'");
+            pos_++;
+        }
+        first_ = false;
+        key = read_string_token();
+        expect(':');
+        return true;
+    }
+
+    void JsonReader::begin_array()
+    {
+        expect('[');
+        first_ = true;
+    }
+
+    bool JsonReader::next_element()
+    {
+        const char ch = skip_whitespace();
+        if (ch == ']')
+        {
+            pos_++;
+            first_ = false;
+            return false;
+        }
+        if (!first_)
+        {
+            if (ch != ',') error("expected ',' or ']'");
+            pos_++;
+        }
+        first_ = false;
+        return true;
+    }
+
+    std::string_view JsonReader::read_string()
+    {
+        if (peek() != Kind::string) error("expected a string");
+        return read_string_token();
+    }
+
+    int64_t JsonReader::read_int()
+    {
+        const std::string_view token = read_number_token();
+        int64_t value = 0;
+        const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (ec != std::errc{} || end != token.data() + token.size()) error("expected an integer");
+        return value;
+    }
+
+    double JsonReader::read_double()
+    {
+        // Unlike strtod, from_chars doesn't depend on the decimal point of the C locale
+        const std::string_view token = read_number_token();
+        double value = 0;
+        const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (ec != std::errc{} || end != token.data() + token.size()) error("expected a number");
+        return value;
+    }
+
+    bool JsonReader::read_bool()
+    {
+        skip_whitespace();
+        const std::string_view rest = text_.substr(pos_);
+        if (starts_with_literal(rest, "true"))
+        {
+            pos_ += 4;
+            return true;
+        }
+        if (starts_with_literal(rest, "false"))
+        {
+            pos_ += 5;
+            return false;
+        }
+        error("expected a boolean");
+    }
+
+    bool JsonReader::read_null()
+    {
+        skip_whitespace();
+        if (!starts_with_literal(text_.substr(pos_), "null")) return false;
+        pos_ += 4;
+        return true;
+    }
+
+    std::string_view JsonReader::peek_string_field(const std::string_view key)
+    {
+        const size_t pos = pos_;
+        const bool first = first_;
+        std::string_view result;
+        begin_object();
+        std::string_view current;
+        while (next_key(current))
+        {
+            if (current == key && peek() == Kind::string)
+            {
+                result = read_string_token();
+                break;
+            }
+            skip();
+        }
+        pos_ = pos;
+        first_ = first;
+        return result;
+    }
+
+    void JsonReader::skip()
+    {
+        switch (peek())
+        {
+            case Kind::null: if (!read_null()) error("expected null"); break;
+            case Kind::boolean: (void)read_bool(); break;
+            case Kind::number: (void)read_number_token(); break;
+            case Kind::string: (void)read_string_token(); break;
+            case Kind::array: read_array([this] { skip(); }); break;
+            case Kind::object: read_object([this](std::string_view) { skip(); }); break;
+        }
+    }
+
+    std::string_view JsonReader::read_raw()
+    {
+        const size_t begin = (skip_whitespace(), pos_);
+        skip();
+        return text_.substr(begin, pos_ - begin);
+    }
+
+    void JsonReader::expect_end()
+    {
+        while (pos_ < text_.size() && is_whitespace(text_[pos_])) pos_++;
+        if (pos_ != text_.size()) error("unexpected trailing characters");
+    }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <initializer_list>
+
+namespace mirai::utils
+{
+    /**
+     * \brief A pull style JSON reader decoding values in a single pass over the text
+     * \details Instead of building a DOM, values are read in document order right
+     * into their destinations. Objects and arrays are read by callbacks, which must
+     * consume exactly one value (read or skip it) each time they are called. <br>
+     * Typed values are decoded through the read_json(JsonReader&, T&) overloads
+     * found by ADL, mirroring the from_json overloads used with nlohmann::json.
+     * \remarks Strings read from the reader are views valid until the next read.
+     * Parse errors throw RuntimeError. <br>
+     * With the MIRAIPP_SIMDJSON build option the text is parsed by simdjson when
+     * the reader is constructed and the reads walk the parsed document instead,
+     * the interface and the decoded values are the same.
+     */
+    class JsonReader final
+    {
+    public:
+        /**
+         * \brief Kind of a JSON value
+         */
+        enum class Kind { null, boolean, number, string, array, object };
+
+    private:
+#ifdef MIRAIPP_SIMDJSON
+        struct Document; // Parsed document and reading state, recycled within a thread
+        struct DocumentDeleter { void operator()(Document* document) const; };
+        std::unique_ptr<Document, DocumentDeleter> document_;
+#else
+        std::string_view text_;
+        size_t pos_ = 0;
+        bool first_ = false; // Whether the innermost container has just begun
+        std::string scratch_; // Storage for unescaped strings
+
+        char skip_whitespace();
+        void expect(char ch);
+        std::string_view read_string_token();
+        std::string_view read_number_token();
+#endif
+        [[noreturn]] void error(const char* what) const;
+
+        [[noreturn]] void missing_member(const std::initializer_list<std::string_view> required,
+            const uint64_t found) const
+        {
+            size_t index = 0;
+            for (const std::string_view member : required)
+                if ((found >> index++ & 1) == 0)
+                    error(("missing member \"" + std::string(member) + '"').c_str());
+            error("missing member");
+        }
+    public:
+        /**
+         * \brief Construct a reader over a JSON text
+         * \param text The text, must outlive the reader
+         */
+        explicit JsonReader(std::string_view text);
+
+        /**
+         * \brief Get the kind of the next value without consuming it
+         * \return The kind
+         */
+        Kind peek();
+
+        /**
+         * \brief Begin reading an object
+         */
+        void begin_object();
+
+        /**
+         * \brief Read the next key of the current object
+         * \param key Output of the key
+         * \return Whether a key is read, false if the object ends
+         */
+        bool next_key(std::string_view& key);
+
+        /**
+         * \brief Begin reading an array
+         */
+        void begin_array();
+
+        /**
+         * \brief Check for the next element of the current array
+         * \return Whether there is one more element, false if the array ends
+         */
+        bool next_element();
+
+        /**
+         * \brief Begin reading an object and advance to the value of a member
+         * \details The value is the next value to read, after which the rest of
+         * the members can be read by next_key as usual.
+         * \param key The key of the member
+         * \return Whether the member is found, if not the whole object is consumed
+         */
+        bool seek_key(const std::string_view key)
+        {
+            begin_object();
+            std::string_view current;
+            while (next_key(current))
+            {
+                if (current == key) return true;
+                skip();
+            }
+            return false;
+        }
+
+        /**
+         * \brief Read an object by calling a callback on every key
+         * \tparam F Type of the callback
+         * \param on_key The callback taking a std::string_view key, which must
+         * consume the corresponding value
+         */
+        template <typename F>
+        void read_object(F&& on_key)
+        {
+            begin_object();
+            std::string_view key;
+            while (next_key(key)) on_key(key);
+        }
+
+        /**
+         * \brief Read an object by calling a callback on every key, and check that
+         * the required members are all present
+         * \details This is the counterpart of nlohmann::json::at() in the from_json
+         * overloads, an object missing a required member throws RuntimeError instead
+         * of leaving the destination as it was.
+         * \tparam F Type of the callback
+         * \param required Keys of the required members, fewer than 64 of them
+         * \param on_key The callback taking a std::string_view key, which must
+         * consume the corresponding value
+         */
+        template <typename F>
+        void read_object(const std::initializer_list<std::string_view> required, F&& on_key)
+        {
+            uint64_t found = 0;
+            read_object([&](const std::string_view key)
+            {
+                // The key is only valid until the value is read
+                size_t index = 0;
+                for (const std::string_view member : required)
+                {
+                    if (member == key)
+                    {
+                        found |= uint64_t(1) << index;
+                        break;
+                    }
+                    index++;
+                }
+                on_key(key);
+            });
+            if (found != (uint64_t(1) << required.size()) - 1) missing_member(required, found);
+        }
+
+        /**
+         * \brief Read an array by calling a callback for every element
+         * \tparam F Type of the callback
+         * \param on_element The callback taking no arguments, which must consume
+         * the element
+         */
+        template <typename F>
+        void read_array(F&& on_element)
+        {
+            begin_array();
+            while (next_element()) on_element();
+        }
+
+        /**
+         * \brief Read a string
+         * \return The unescaped string, valid until the next read
+         */
+        std::string_view read_string();
+
+        /**
+         * \brief Read an integer
+         * \return The integer
+         */
+        int64_t read_int();
+
+        /**
+         * \brief Read a floating point number
+         * \return The number
+         */
+        double read_double();
+
+        /**
+         * \brief Read a boolean
+         * \return The boolean
+         */
+        bool read_bool();
+
+        /**
+         * \brief Consume a null value if the next value is null
+         * \return Whether a null is consumed
+         */
+        bool read_null();
+
+        /**
+         * \brief Find a string member of the next object without consuming anything
+         * \details This is for dispatching on a tag like "type" before decoding the
+         * object, the members before the tag are scanned over and then read again.
+         * \param key The key of the member
+         * \return The string, empty if the object has no such member or the value is
+         * not a string, valid until the next read
+         */
+        std::string_view peek_string_field(std::string_view key);
+
+        /**
+         * \brief Skip the next value
+         */
+        void skip();
+
+        /**
+         * \brief Skip the next value and get its raw JSON text
+         * \return The raw text, a view into the original text, or the minified
+         * value valid until the next read with the simdjson backend
+         */
+        std::string_view read_raw();
+
+        /**
+         * \brief Check that there is nothing but whitespaces left in the text
+         */
+        void expect_end();
+    };
+
+    inline void read_json(JsonReader& reader, std::string& value) { value = reader.read_string(); }
+    inline void read_json(JsonReader& reader, bool& value) { value = reader.read_bool(); }
+    inline void read_json(JsonReader& reader, double& value) { value = reader.read_double(); }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T>>* = nullptr>
+    void read_json(JsonReader& reader, T& value) { value = static_cast<T>(reader.read_int()); }
+
+    template <typename T>
+    void read_json(JsonReader& reader, std::optional<T>& value)
+    {
+        if (reader.read_null())
+            value = std::nullopt;
+        else
+            read_json(reader, value ? *value : value.emplace());
+    }
+
+    // Existing elements are read into in place, so that they keep their storage
+    template <typename T>
+    void read_json(JsonReader& reader, std::vector<T>& value)
+    {
+        size_t size = 0;
+        reader.read_array([&]
+        {
+            read_json(reader, size < value.size() ? value[size] : value.emplace_back());
+            size++;
+        });
+        value.resize(size);
+    }
+
+    /**
+     * \brief Read a value of a type
+     * \tparam T Type of the value
+     * \param reader The reader
+     * \return The value
+     */
+    template <typename T>
+    T read_json_value(JsonReader& reader)
+    {
+        T value = T();
+        read_json(reader, value);
+        return value;
+    }
+
+    /**
+     * \brief Decode a whole JSON text into a value
+     * \tparam T Type of the value
+     * \param text The text
+     * \return The value
+     */
+    template <typename T>
+    T read_json_text(const std::string_view text)
+    {
+        JsonReader reader(text);
+        T value = read_json_value<T>(reader);
+        reader.expect_end();
+        return value;
+    }
+}
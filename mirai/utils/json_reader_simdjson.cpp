@@ -0,0 +1,203 @@
+#include "json_reader.h"
+#include <simdjson.h>
+#include "string.h"
+#include "../core/common.h"
+
+// The simdjson backend of JsonReader, built instead of json_reader.cpp with the
+// MIRAIPP_SIMDJSON option. The whole text is parsed up front into simdjson's
+// tape, and the reads walk the tape with a stack of iterators, one for each
+// container being read.
+
+namespace mirai::utils
+{
+    namespace dom = simdjson::dom;
+
+    struct JsonReader::Document
+    {
+        struct Frame
+        {
+            bool is_object = false;
+            dom::object::iterator member, members_end;
+            dom::array::iterator element, elements_end;
+        };
+
+        dom::parser parser; // Keeps the buffers between parses
+        dom::element next; // The next value to read
+        bool has_next = false;
+        std::vector<Frame> frames;
+        std::string scratch; // Storage for raw texts
+
+        // Documents are recycled within a thread so that steady state decoding
+        // does not allocate, more than one document is needed when readers nest
+        static std::vector<std::unique_ptr<Document>>& free_list()
+        {
+            thread_local std::vector<std::unique_ptr<Document>> documents;
+            return documents;
+        }
+    };
+
+    void JsonReader::DocumentDeleter::operator()(Document* document) const
+    {
+        document->frames.clear();
+        document->has_next = false;
+        Document::free_list().emplace_back(document);
+    }
+
+    JsonReader::JsonReader(const std::string_view text)
+    {
+        auto& free_list = Document::free_list();
+        if (free_list.empty())
+            document_.reset(new Document);
+        else
+        {
+            document_.reset(free_list.back().release());
+            free_list.pop_back();
+        }
+        // The text is copied into the padded buffer owned by the parser
+        if (const auto error_code = document_->parser.parse(text.data(), text.size(), true).get(document_->next))
+            throw RuntimeError(strcat("JSON parse error: ", simdjson::error_message(error_code)));
+        document_->has_next = true;
+    }
+
+    void JsonReader::error(const char* what) const
+    {
+        throw RuntimeError(strcat("JSON parse error: ", what));
+    }
+
+    JsonReader::Kind JsonReader::peek()
+    {
+        if (!document_->has_next) error("no value to read");
+        switch (document_->next.type())
+        {
+            case dom::element_type::NULL_VALUE: return Kind::null;
+            case dom::element_type::BOOL: return Kind::boolean;
+            case dom::element_type::STRING: return Kind::string;
+            case dom::element_type::ARRAY: return Kind::array;
+            case dom::element_type::OBJECT: return Kind::object;
+            default: return Kind::number;
+        }
+    }
+
+    void JsonReader::begin_object()
+    {
+        dom::object object;
+        if (peek() != Kind::object || document_->next.get_object().get(object)) error("expected an object");
+        document_->has_next = false;
+        auto& frame = document_->frames.emplace_back();
+        frame.is_object = true;
+        frame.member = object.begin();
+        frame.members_end = object.end();
+    }
+
+    bool JsonReader::next_key(std::string_view& key)
+    {
+        auto& frames = document_->frames;
+        if (frames.empty() || !frames.back().is_object || document_->has_next)
+            error("not at a key of an object");
+        auto& frame = frames.back();
+        if (!(frame.member != frame.members_end))
+        {
+            frames.pop_back();
+            return false;
+        }
+        key = frame.member.key();
+        document_->next = frame.member.value();
+        document_->has_next = true;
+        ++frame.member;
+        return true;
+    }
+
+    void JsonReader::begin_array()
+    {
+        dom::array array;
+        if (peek() != Kind::array || document_->next.get_array().get(array)) error("expected an array");
+        document_->has_next = false;
+        auto& frame = document_->frames.emplace_back();
+        frame.element = array.begin();
+        frame.elements_end = array.end();
+    }
+
+    bool JsonReader::next_element()
+    {
+        auto& frames = document_->frames;
+        if (frames.empty() || frames.back().is_object || document_->has_next)
+            error("not at an element of an array");
+        auto& frame = frames.back();
+        if (!(frame.element != frame.elements_end))
+        {
+            frames.pop_back();
+            return false;
+        }
+        document_->next = *frame.element;
+        document_->has_next = true;
+        ++frame.element;
+        return true;
+    }
+
+    std::string_view JsonReader::read_string()
+    {
+        std::string_view value;
+        if (peek() != Kind::string || document_->next.get_string().get(value)) error("expected a string");
+        document_->has_next = false;
+        return value;
+    }
+
+    int64_t JsonReader::read_int()
+    {
+        int64_t value = 0;
+        if (peek() != Kind::number || document_->next.get_int64().get(value)) error("expected an integer");
+        document_->has_next = false;
+        return value;
+    }
+
+    double JsonReader::read_double()
+    {
+        double value = 0;
+        if (peek() != Kind::number || document_->next.get_double().get(value)) error("expected a number");
+        document_->has_next = false;
+        return value;
+    }
+
+    bool JsonReader::read_bool()
+    {
+        bool value = false;
+        if (peek() != Kind::boolean || document_->next.get_bool().get(value)) error("expected a boolean");
+        document_->has_next = false;
+        return value;
+    }
+
+    bool JsonReader::read_null()
+    {
+        if (peek() != Kind::null) return false;
+        document_->has_next = false;
+        return true;
+    }
+
+    std::string_view JsonReader::peek_string_field(const std::string_view key)
+    {
+        dom::object object;
+        if (peek() != Kind::object || document_->next.get_object().get(object)) error("expected an object");
+        std::string_view result;
+        if (object.at_key(key).get_string().get(result)) return {};
+        return result;
+    }
+
+    void JsonReader::skip()
+    {
+        (void)peek();
+        document_->has_next = false;
+    }
+
+    std::string_view JsonReader::read_raw()
+    {
+        (void)peek();
+        document_->scratch = simdjson::minify(document_->next);
+        document_->has_next = false;
+        return document_->scratch;
+    }
+
+    void JsonReader::expect_end()
+    {
+        if (document_->has_next || !document_->frames.empty()) error("unexpected trailing values");
+    }
+}
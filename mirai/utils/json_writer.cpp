@@ -0,0 +1,126 @@
+#include "json_writer.h"
+#include <charconv>
+#include "../core/common.h"
+
+namespace mirai::utils
+{
+    namespace
+    {
+        // Length of the well-formed UTF-8 sequence starting at a non-ASCII byte, 0 if it is
+        // ill-formed, overlong encodings, surrogates and code points beyond U+10FFFF included
+        size_t utf8_sequence_length(const std::string_view str, const size_t i)
+        {
+            const auto continues = [&](const size_t j, const unsigned char low = 0x80, const unsigned char high = 0xbf)
+            {
+                if (j >= str.size()) return false;
+                const auto byte = static_cast<unsigned char>(str[j]);
+                return byte >= low && byte <= high;
+            };
+            const auto lead = static_cast<unsigned char>(str[i]);
+            if (lead >= 0xc2 && lead <= 0xdf) return continues(i + 1) ? 2 : 0;
+            if (lead == 0xe0) return continues(i + 1, 0xa0) && continues(i + 2) ? 3 : 0;
+            if (lead == 0xed) return continues(i + 1, 0x80, 0x9f) && continues(i + 2) ? 3 : 0;
+            if (lead >= 0xe1 && lead <= 0xef) return continues(i + 1) && continues(i + 2) ? 3 : 0;
+            if (lead == 0xf0) return continues(i + 1, 0x90) && continues(i + 2) && continues(i + 3) ? 4 : 0;
+            if (lead == 0xf4) return continues(i + 1, 0x80, 0x8f) && continues(i + 2) && continues(i + 3) ? 4 : 0;
+            if (lead >= 0xf1 && lead <= 0xf3) return continues(i + 1) && continues(i + 2) && continues(i + 3) ? 4 : 0;
+            return 0;
+        }
+    }
+
+    void JsonWriter::write_escaped(const std::string_view str)
+    {
+        static constexpr char hex_digits[] = "0123456789abcdef";
+        out_ += '"';
+        size_t begin = 0; // Start of the run of characters not yet copied
+        for (size_t i = 0; i < str.size(); i++)
+        {
+            const auto ch = static_cast<unsigned char>(str[i]);
+            if (ch >= 0x80)
+            {
+                // Reject what nlohmann::json::dump() would reject instead of writing it through
+                const size_t length = utf8_sequence_length(str, i);
+                if (length == 0)
+                    throw RuntimeError("Invalid UTF-8 byte at index " + std::to_string(i) +
+                        " of a string written to JSON");
+                i += length - 1;
+                continue;
+            }
+            if (ch >= 0x20 && ch != '"' && ch != '\\') continue;
+            out_.append(str.data() + begin, i - begin);
+            begin = i + 1;
+            switch (ch)
+            {
+                case '"': out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\b': out_ += "\\b"; break;
+                case '\f': out_ += "\\f"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                default:
+                {
+                    const char escape[] = { '\\', 'u', '0', '0', hex_digits[ch >> 4], hex_digits[ch & 0xf] };
+                    out_.append(escape, sizeof(escape));
+                    break;
+                }
+            }
+        }
+        out_.append(str.data() + begin, str.size() - begin);
+        out_ += '"';
+    }
+
+    void JsonWriter::write_key(const std::string_view key)
+    {
+        separate();
+        write_escaped(key);
+        out_ += ':';
+        comma_ = false;
+    }
+
+    void JsonWriter::write_string(const std::string_view str)
+    {
+        separate();
+        write_escaped(str);
+        comma_ = true;
+    }
+
+    void JsonWriter::write_int(const int64_t value)
+    {
+        separate();
+        char buffer[24];
+        const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, end);
+        comma_ = true;
+    }
+
+    void JsonWriter::write_uint(const uint64_t value)
+    {
+        separate();
+        char buffer[24];
+        const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, end);
+        comma_ = true;
+    }
+
+    void JsonWriter::write_bool(const bool value)
+    {
+        separate();
+        out_ += value ? "true" : "false";
+        comma_ = true;
+    }
+
+    void JsonWriter::write_null()
+    {
+        separate();
+        out_ += "null";
+        comma_ = true;
+    }
+
+    void JsonWriter::write_raw(const std::string_view json)
+    {
+        separate();
+        out_ += json;
+        comma_ = true;
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace mirai::utils
+{
+    /**
+     * \brief A JSON writer appending values in document order to a string buffer
+     * \details The writer keeps no state other than whether a separator is due,
+     * so the buffer can be reused across requests to keep its capacity. Commas
+     * between members and elements are inserted automatically. <br>
+     * Typed values are encoded through the write_json(JsonWriter&, const T&)
+     * overloads found by ADL, mirroring the read_json overloads of JsonReader.
+     * Strings are escaped in the same way as nlohmann::json::dump() does, and
+     * strings that are not valid UTF-8 are likewise rejected with a RuntimeError.
+     * \remarks The writer does not check the structure of the document, keys
+     * must be written before the values inside of objects.
+     */
+    class JsonWriter final
+    {
+    private:
+        std::string& out_;
+        bool comma_ = false; // Whether a separator is due before the next member or element
+
+        void separate()
+        {
+            if (comma_) out_ += ',';
+        }
+
+        void write_escaped(std::string_view str);
+    public:
+        /**
+         * \brief Construct a writer appending to a buffer
+         * \param out The buffer, must outlive the writer
+         */
+        explicit JsonWriter(std::string& out): out_(out) {}
+
+        /**
+         * \brief Get the buffer written to
+         * \return Reference to the buffer
+         */
+        std::string& buffer() const { return out_; }
+
+        /**
+         * \brief Begin writing an object
+         */
+        void begin_object()
+        {
+            separate();
+            out_ += '{';
+            comma_ = false;
+        }
+
+        /**
+         * \brief Continue writing an object from a pre-encoded fragment
+         * \param fragment The fragment, which begins an object with at least one
+         * member but does not end it, e.g. {"sessionKey":"abc"
+         */
+        void continue_object(const std::string_view fragment)
+        {
+            separate();
+            out_ += fragment;
+            comma_ = true;
+        }
+
+        /**
+         * \brief End writing an object
+         */
+        void end_object()
+        {
+            out_ += '}';
+            comma_ = true;
+        }
+
+        /**
+         * \brief Begin writing an array
+         */
+        void begin_array()
+        {
+            separate();
+            out_ += '[';
+            comma_ = false;
+        }
+
+        /**
+         * \brief End writing an array
+         */
+        void end_array()
+        {
+            out_ += ']';
+            comma_ = true;
+        }
+
+        /**
+         * \brief Write a key of the current object
+         * \param key The key
+         */
+        void write_key(std::string_view key);
+
+        /**
+         * \brief Write a string, throw RuntimeError if it is not valid UTF-8
+         * \param str The string to be escaped
+         */
+        void write_string(std::string_view str);
+
+        /**
+         * \brief Write a signed integer
+         * \param value The integer
+         */
+        void write_int(int64_t value);
+
+        /**
+         * \brief Write an unsigned integer
+         * \param value The integer
+         */
+        void write_uint(uint64_t value);
+
+        /**
+         * \brief Write a boolean
+         * \param value The boolean
+         */
+        void write_bool(bool value);
+
+        /**
+         * \brief Write a null value
+         */
+        void write_null();
+
+        /**
+         * \brief Write a pre-encoded JSON value as is
+         * \param json The JSON text of exactly one value
+         */
+        void write_raw(std::string_view json);
+
+        /**
+         * \brief Write a member of the current object
+         * \tparam T Type of the value
+         * \param key The key
+         * \param value The value, written by write_json
+         */
+        template <typename T>
+        void write_field(const std::string_view key, const T& value)
+        {
+            write_key(key);
+            write_json(*this, value);
+        }
+    };
+
+    inline void write_json(JsonWriter& writer, const std::string_view value) { writer.write_string(value); }
+    inline void write_json(JsonWriter& writer, const std::string& value) { writer.write_string(value); }
+    inline void write_json(JsonWriter& writer, const char* value) { writer.write_string(value); }
+    inline void write_json(JsonWriter& writer, const bool value) { writer.write_bool(value); }
+    inline void write_json(JsonWriter& writer, std::nullptr_t) { writer.write_null(); }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>>* = nullptr>
+    void write_json(JsonWriter& writer, const T value) { writer.write_int(value); }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> &&
+        !std::is_same_v<T, bool>>* = nullptr>
+    void write_json(JsonWriter& writer, const T value) { writer.write_uint(value); }
+
+    template <typename T>
+    void write_json(JsonWriter& writer, const std::optional<T>& value)
+    {
+        if (value)
+            write_json(writer, *value);
+        else
+            writer.write_null();
+    }
+
+    template <typename T>
+    void write_json(JsonWriter& writer, const std::vector<T>& value)
+    {
+        writer.begin_array();
+        for (const T& element : value) write_json(writer, element);
+        writer.end_array();
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+
+namespace mirai::utils
+{
+    /**
+     * \brief A perfect hash table mapping a fixed set of names to their indices,
+     * built at compile time
+     * \details The hash only mixes the length with the first, the middle and the
+     * last characters of a name, using a seed searched for at compile time such that
+     * no two names share a slot. A lookup costs a few instructions and at most one
+     * string comparison regardless of the amount of names. <br>
+     * Constructing the table in a constant expression fails to compile if the
+     * names are not unique, which also catches missing entries left empty, or if
+     * two names agree on all the sampled characters.
+     * \tparam N Amount of the names
+     */
+    template <size_t N>
+    class NameIndex final
+    {
+        static_assert(N > 0 && N < 255, "NameIndex supports 1 to 254 names");
+
+    public:
+        static constexpr size_t npos = N; ///< The index returned for names not in the table
+
+    private:
+        static constexpr size_t table_size = []
+        {
+            size_t size = 1;
+            while (size < 4 * N) size *= 2;
+            return size;
+        }();
+        static constexpr uint32_t max_seed = 1u << 16;
+
+        std::array<std::string_view, N> names_{};
+        std::array<uint8_t, table_size> slots_{}; // Index of the name plus 1, 0 for empty slots
+        uint32_t seed_ = 0;
+
+        static constexpr size_t slot_of(const std::string_view name, const uint32_t seed)
+        {
+            const size_t size = name.size();
+            uint32_t hash = (2166136261u ^ seed) + static_cast<uint32_t>(size) * 2654435761u;
+            if (size != 0)
+            {
+                hash = (hash ^ static_cast<uint8_t>(name[0])) * 16777619u;
+                hash = (hash ^ static_cast<uint8_t>(name[size / 2])) * 16777619u;
+                hash = (hash ^ static_cast<uint8_t>(name[size - 1])) * 16777619u;
+            }
+            return (hash ^ hash >> 15) & (table_size - 1);
+        }
+
+        constexpr bool try_seed(const uint32_t seed)
+        {
+            slots_ = {};
+            for (size_t i = 0; i < N; i++)
+            {
+                uint8_t& slot = slots_[slot_of(names_[i], seed)];
+                if (slot != 0) return false;
+                slot = static_cast<uint8_t>(i + 1);
+            }
+            seed_ = seed;
+            return true;
+        }
+
+    public:
+        /**
+         * \brief Build the table
+         * \param names The names, the index of a name in this array is the value
+         * it maps to
+         */
+        constexpr explicit NameIndex(const std::array<std::string_view, N>& names): names_(names)
+        {
+            for (size_t i = 0; i < N; i++)
+                for (size_t j = 0; j < i; j++)
+                    if (names_[i] == names_[j]) throw "Duplicate names in NameIndex";
+            for (uint32_t seed = 0; seed < max_seed; seed++)
+                if (try_seed(seed)) return;
+            throw "No perfect hash seed found for NameIndex";
+        }
+
+        /**
+         * \brief Find the index of a name
+         * \param name The name
+         * \return The index, or npos if the name is not in the table
+         */
+        constexpr size_t find(const std::string_view name) const
+        {
+            const size_t slot = slots_[slot_of(name, seed_)];
+            return slot != 0 && names_[slot - 1] == name ? slot - 1 : npos;
+        }
+
+        /**
+         * \brief Get the seed of the hash function
+         * \return The seed
+         */
+        constexpr uint32_t seed() const { return seed_; }
+    };
+
+    template <size_t N>
+    NameIndex(const std::array<std::string_view, N>&) -> NameIndex<N>;
+}
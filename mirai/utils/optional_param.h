@@ -1,6 +1,7 @@
 #pragma once
 
 #include <utility>
+#include <optional>
 
 namespace mirai::utils
 {
@@ -30,6 +31,12 @@ namespace mirai::utils
          */
         OptionalParam(const T& value) : ptr_(&value) {}
 
+        /**
+         * \brief Construct an optional parameter referring to the value of an optional
+         * \param value A const reference to the optional
+         */
+        OptionalParam(const std::optional<T>& value) : ptr_(value ? &*value : nullptr) {}
+
         /**
          * \brief Get a pointer to the object, will be nullptr if empty
          * \return The pointer
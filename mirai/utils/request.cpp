@@ -1,36 +1,236 @@
 #include "request.h"
+#include <thread>
+#include <cctype>
 #include <cpr/cpr.h>
 #include "../core/common.h"
 
 namespace mirai::utils
 {
-    std::string get_no_parse(const std::string_view url, const cpr::Parameters& parameters)
+    namespace
     {
-        const cpr::Response response = Get(
-            cpr::Url{ std::string(base_url) += url }, parameters);
-        if (response.status_code != 200) // Status code not OK
-            throw RuntimeError(response.error.message);
-        return response.text;
+        const cpr::Header json_header{ { "Content-Type", "application/json; charset=utf-8" } };
+
+        // Transport errors and server side errors may go away on their own,
+        // other statuses would just fail again
+        bool is_transient(const cpr::Response& response)
+        {
+            return response.status_code == 0 || response.status_code >= 500;
+        }
+
+        void append_url_encoded(std::string& buffer, const std::string_view text)
+        {
+            static constexpr char hex_digits[] = "0123456789ABCDEF";
+            for (const char ch : text)
+            {
+                const auto byte = static_cast<unsigned char>(ch);
+                if (std::isalnum(byte) || ch == '-' || ch == '.' || ch == '_' || ch == '~')
+                    buffer += ch;
+                else
+                {
+                    buffer += '%';
+                    buffer += hex_digits[byte >> 4];
+                    buffer += hex_digits[byte & 15];
+                }
+            }
+        }
+
+        using Clock = std::chrono::steady_clock;
+
+        // Time left before the deadline, rounded up since zero means no limit to cpr
+        std::chrono::milliseconds time_left(const Clock::time_point deadline)
+        {
+            using namespace std::chrono;
+            if (deadline == Clock::time_point::max()) return milliseconds(0);
+            const auto left = ceil<milliseconds>(deadline - Clock::now());
+            return std::max(left, milliseconds(1));
+        }
+
+        [[noreturn]] void throw_response_error(const cpr::Response& response)
+        {
+            if (!response.error.message.empty()) throw RuntimeError(response.error.message);
+            throw RuntimeError("HTTP status code " + std::to_string(response.status_code));
+        }
+    }
+
+    CircuitBreaker::Admission HttpClient::acquire_breaker(const std::string_view url)
+    {
+        if (breaker_policy_.failure_threshold == 0) return {};
+        CircuitBreaker::Admission admission;
+        {
+            std::lock_guard lock(breaker_mutex_);
+            auto iter = breakers_.find(url);
+            if (iter == breakers_.end()) iter = breakers_.emplace(std::string(url), CircuitBreaker{}).first;
+            admission = iter->second.acquire(breaker_policy_);
+        }
+        switch (admission.decision)
+        {
+            case CircuitBreaker::Decision::allow: return admission;
+            case CircuitBreaker::Decision::probe: counters_.circuit_probes++; return admission;
+            case CircuitBreaker::Decision::reject:
+                counters_.circuit_rejections++;
+                throw CircuitOpenError("Circuit breaker is open for " + std::string(url));
+        }
+        return admission;
+    }
+
+    void HttpClient::record_breaker(const std::string_view url,
+        const CircuitBreaker::Admission& admission, const bool success)
+    {
+        if (breaker_policy_.failure_threshold == 0) return;
+        std::lock_guard lock(breaker_mutex_);
+        // The breaker was inserted by acquire_breaker and never removed
+        if (breakers_.find(url)->second.record(breaker_policy_, admission, success))
+            counters_.circuit_trips++;
+    }
+
+    template <typename F>
+    std::string HttpClient::perform(const std::string_view url, const bool idempotent, F&& request)
+    {
+        const size_t attempts = idempotent && retry_.max_attempts != 0 ? retry_.max_attempts : 1;
+        const Clock::time_point deadline = timeouts_.request.count() > 0 ?
+            Clock::now() + timeouts_.request : Clock::time_point::max();
+        for (size_t attempt = 1;; attempt++)
+        {
+            cpr::Response response;
+            CircuitBreaker::Admission admission;
+            {
+                auto session = prepare(url, deadline);
+                admission = acquire_breaker(url);
+                // Every request let through by the breaker must be recorded, otherwise
+                // a half-open breaker would wait for the result of its probe forever
+                try
+                {
+                    counters_.requests++;
+                    session->SetTimeout(cpr::Timeout{ time_left(deadline) });
+                    session->SetConnectTimeout(cpr::ConnectTimeout{ timeouts_.connect });
+                    response = request(*session, session.url_buffer(), attempt >= attempts);
+                }
+                catch (...)
+                {
+                    record_breaker(url, admission, false);
+                    throw;
+                }
+            } // Return the connection to the pool before backing off
+            const bool transient = is_transient(response);
+            record_breaker(url, admission, !transient);
+            if (response.status_code == 200) return std::move(response.text);
+            counters_.failures++;
+            const bool timed_out = response.error.code == cpr::ErrorCode::OPERATION_TIMEDOUT;
+            if (!transient || attempt >= attempts)
+            {
+                if (!timed_out) throw_response_error(response);
+                counters_.timeouts++;
+                throw TimeoutError(response.error.message);
+            }
+            // Only retry if there is still time left after backing off
+            const auto delay = backoff_delay(retry_, attempt - 1);
+            if (Clock::now() + delay >= deadline)
+            {
+                counters_.timeouts++;
+                throw TimeoutError(timed_out ? response.error.message :
+                    "Deadline reached before retrying the request to " + std::string(url));
+            }
+            counters_.retries++;
+            std::this_thread::sleep_for(delay);
+        }
+    }
+
+    ConnectionPool::Lease HttpClient::prepare(const std::string_view url, const Clock::time_point deadline)
+    {
+        auto session = [&]
+        {
+            if (deadline == Clock::time_point::max()) return pool_.acquire();
+            if (auto lease = pool_.acquire_until(deadline)) return std::move(*lease);
+            counters_.timeouts++;
+            throw TimeoutError("Deadline reached while waiting for a connection to " + std::string(url));
+        }();
+        // The buffer keeps its capacity, so building the URL does not allocate once
+        // warmed up, though cpr still copies it into a temporary cpr::Url on SetUrl
+        session.url_buffer().assign(base_url_).append(url);
+        return session;
+    }
+
+    HttpClient::HttpClient(const std::string_view host, const size_t max_connections,
+        const RetryPolicy& retry, const CircuitBreakerPolicy& circuit_breaker, const TimeoutPolicy& timeouts):
+        base_url_(host), pool_(max_connections), retry_(retry), breaker_policy_(circuit_breaker),
+        timeouts_(timeouts) {}
+
+    RequestStats HttpClient::stats() const
+    {
+        return {
+            counters_.requests.load(),
+            counters_.failures.load(),
+            counters_.retries.load(),
+            counters_.timeouts.load(),
+            counters_.circuit_trips.load(),
+            counters_.circuit_probes.load(),
+            counters_.circuit_rejections.load()
+        };
+    }
+
+    CircuitBreaker::State HttpClient::circuit_state(const std::string_view url)
+    {
+        std::lock_guard lock(breaker_mutex_);
+        const auto iter = breakers_.find(url);
+        return iter != breakers_.end() ? iter->second.state() : CircuitBreaker::State::closed;
     }
 
-    json get(const std::string_view url, const cpr::Parameters& parameters)
+    std::string HttpClient::get(const std::string_view url, const ArrayProxy<QueryParameter> parameters)
     {
-        return json::parse(get_no_parse(url, parameters));
+        return perform(url, true, [&](cpr::Session& session, std::string& full_url, bool)
+        {
+            // Append the query string to the URL in the reused buffer instead of
+            // going through cpr::Parameters which builds a new string each time
+            char separator = '?';
+            for (const auto& [key, value] : parameters)
+            {
+                full_url += separator;
+                append_url_encoded(full_url, key);
+                full_url += '=';
+                append_url_encoded(full_url, value);
+                separator = '&';
+            }
+            session.SetUrl(full_url);
+            session.SetHeader(cpr::Header{});
+            return session.Get();
+        });
     }
 
-    std::string post_json_no_parse(const std::string_view url, const json& json)
+    std::string HttpClient::post_json(const std::string_view url, const std::string_view body, const bool idempotent)
     {
-        const cpr::Response response = Post(cpr::Url{ std::string(base_url) += url },
-            cpr::Header{ { "Content-Type", "application/json; charset=utf-8" } },
-            cpr::Body{ json.dump() });
-        if (response.status_code != 200) // Status code not OK
-            throw RuntimeError(response.error.message);
-        return response.text;
+        // One body for all the attempts, cpr keeps its own copy of the body for the
+        // attempts that may be retried and takes this one over on the last attempt
+        cpr::Body payload{ std::string(body) };
+        return perform(url, idempotent, [&](cpr::Session& session, const std::string& full_url, const bool last_attempt)
+        {
+            session.SetUrl(full_url);
+            session.SetHeader(json_header);
+            if (last_attempt)
+                session.SetBody(std::move(payload));
+            else
+                session.SetBody(payload);
+            return session.Post();
+        });
     }
 
-    json post_json(const std::string_view url, const json& json)
+    std::string HttpClient::post_multipart(const std::string_view url, const ArrayProxy<FormField> fields)
     {
-        return json::parse(post_json_no_parse(url, json));
+        cpr::Multipart multipart{};
+        multipart.parts.reserve(fields.size());
+        for (const auto& [name, value, is_file] : fields)
+        {
+            if (is_file)
+                multipart.parts.emplace_back(std::string(name), cpr::File(value));
+            else
+                multipart.parts.emplace_back(std::string(name), value);
+        }
+        return perform(url, false, [&](cpr::Session& session, const std::string& full_url, bool)
+        {
+            session.SetUrl(full_url);
+            session.SetHeader(cpr::Header{});
+            session.SetMultipart(multipart);
+            return session.Post();
+        });
     }
 
     void check_response(const json& json)
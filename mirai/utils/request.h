@@ -1,47 +1,171 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 #include <nlohmann/json.hpp>
-
-namespace cpr
-{
-    class Parameters;
-}
+#include "connection_pool.h"
+#include "retry.h"
+#include "array_proxy.h"
 
 namespace mirai::utils
 {
     using json = nlohmann::json;
 
     /**
-     * \brief GET request, throw if status code is not 200 (OK)
-     * \param url The URL, relative to base_url
-     * \param parameters The parameters
-     * \return The text part of the response
+     * \brief A query parameter of a GET request
+     */
+    struct QueryParameter final
+    {
+        std::string_view key; ///< Key of the parameter
+        std::string value; ///< Value of the parameter, percent-encoded when sent
+    };
+
+    /**
+     * \brief A field of a multipart form
      */
-    std::string get_no_parse(std::string_view url, const cpr::Parameters& parameters);
+    struct FormField final
+    {
+        std::string_view name; ///< Name of the field
+        std::string value; ///< Value of the field, or the file path for file fields
+        bool is_file = false; ///< Whether the content of the file at the path is sent
+    };
 
     /**
-     * \brief GET request, throw if status code is not 200 (OK), parse text into json
-     * \param url The URL, relative to base_url
-     * \param parameters The parameters
-     * \return The text part of the response, parsed into json
+     * \brief Timeouts of the requests of a HTTP client
+     * \remarks Both are off by default, so large uploads are never cut short
      */
-    json get(std::string_view url, const cpr::Parameters& parameters);
+    struct TimeoutPolicy final
+    {
+        std::chrono::milliseconds connect{ 0 }; ///< Timeout of establishing a connection, 0 for no limit
+        std::chrono::milliseconds request{ 0 }; ///< Deadline of a request including all the retries, 0 for no limit
+    };
 
     /**
-     * \brief POST request, throw if status code is not 200 (OK)
-     * \param url The URL, relative to base_url
-     * \param json The parameters
-     * \return The text part of the response
+     * \brief Snapshot of the request counters of a HTTP client
      */
-    std::string post_json_no_parse(std::string_view url, const json& json);
+    struct RequestStats final
+    {
+        uint64_t requests = 0; ///< Requests sent to the server, retries included
+        uint64_t failures = 0; ///< Requests that did not get a status code 200 (OK)
+        uint64_t retries = 0; ///< Retries of failed idempotent requests
+        uint64_t timeouts = 0; ///< Requests failed by reaching their deadlines
+        uint64_t circuit_trips = 0; ///< Times a circuit breaker opened
+        uint64_t circuit_probes = 0; ///< Half-open probes sent to the server
+        uint64_t circuit_rejections = 0; ///< Requests rejected by open circuit breakers
+    };
 
     /**
-     * \brief POST request, throw if status code is not 200 (OK), parse text into json
-     * \param url The URL, relative to base_url
-     * \param json The parameters
-     * \return The text part of the response, parsed into json
+     * \brief A HTTP client sending requests to one mirai-http-api server through
+     * its own pool of kept-alive connections
+     * \details Requests failed by a transport error or a 5xx status code are
+     * retried with jittered exponential backoff according to the retry policy,
+     * if the request is idempotent. Every endpoint has its own circuit breaker,
+     * requests to an endpoint with an open breaker throw a CircuitOpenError
+     * without contacting the server. Every request has a deadline covering
+     * waiting for a pooled connection and all the retries, a TimeoutError is
+     * thrown when the deadline is reached.
+     * \remarks The client is thread safe
      */
-    json post_json(std::string_view url, const json& json);
+    class HttpClient final
+    {
+    private:
+        struct Counters
+        {
+            std::atomic<uint64_t> requests{ 0 };
+            std::atomic<uint64_t> failures{ 0 };
+            std::atomic<uint64_t> retries{ 0 };
+            std::atomic<uint64_t> timeouts{ 0 };
+            std::atomic<uint64_t> circuit_trips{ 0 };
+            std::atomic<uint64_t> circuit_probes{ 0 };
+            std::atomic<uint64_t> circuit_rejections{ 0 };
+        };
+
+        std::string base_url_;
+        ConnectionPool pool_;
+        RetryPolicy retry_;
+        CircuitBreakerPolicy breaker_policy_;
+        TimeoutPolicy timeouts_;
+        std::mutex breaker_mutex_;
+        std::map<std::string, CircuitBreaker, std::less<>> breakers_;
+        Counters counters_;
+
+        ConnectionPool::Lease prepare(std::string_view url, std::chrono::steady_clock::time_point deadline);
+        CircuitBreaker::Admission acquire_breaker(std::string_view url);
+        void record_breaker(std::string_view url, const CircuitBreaker::Admission& admission, bool success);
+        template <typename F> std::string perform(std::string_view url, bool idempotent, F&& request);
+    public:
+        /**
+         * \brief Construct a HTTP client
+         * \param host Host of the server, every request URL is relative to it
+         * \param max_connections Maximum amount of kept-alive connections,
+         * 0 for the hardware concurrency
+         * \param retry The retry policy for idempotent requests
+         * \param circuit_breaker The policy of the per-endpoint circuit breakers
+         * \param timeouts The timeouts of the requests
+         */
+        HttpClient(std::string_view host, size_t max_connections,
+            const RetryPolicy& retry = {}, const CircuitBreakerPolicy& circuit_breaker = {},
+            const TimeoutPolicy& timeouts = {});
+
+        /**
+         * \brief Get the host of the server
+         * \return The host
+         */
+        const std::string& base_url() const { return base_url_; }
+
+        /**
+         * \brief Get the connection pool of this client
+         * \return Reference to the pool
+         */
+        ConnectionPool& connection_pool() { return pool_; }
+
+        /**
+         * \brief Get the connection pool of this client
+         * \return Const reference to the pool
+         */
+        const ConnectionPool& connection_pool() const { return pool_; }
+
+        /**
+         * \brief Get a snapshot of the request counters
+         * \return The counters
+         */
+        RequestStats stats() const;
+
+        /**
+         * \brief Get the state of the circuit breaker of an endpoint
+         * \param url The endpoint URL, relative to the host
+         * \return The state, closed if the endpoint has not been requested
+         */
+        CircuitBreaker::State circuit_state(std::string_view url);
+
+        /**
+         * \brief GET request, throw if status code is not 200 (OK)
+         * \remarks GET requests are always treated as idempotent
+         * \param url The URL, relative to the host
+         * \param parameters The query parameters
+         * \return The text part of the response
+         */
+        std::string get(std::string_view url, ArrayProxy<QueryParameter> parameters = {});
+
+        /**
+         * \brief POST request with a JSON body, throw if status code is not 200 (OK)
+         * \param url The URL, relative to the host
+         * \param body The serialized JSON body
+         * \param idempotent Whether the request can be retried safely
+         * \return The text part of the response
+         */
+        std::string post_json(std::string_view url, std::string_view body, bool idempotent = false);
+
+        /**
+         * \brief POST multipart form data, throw if status code is not 200 (OK)
+         * \param url The URL, relative to the host
+         * \param fields The form fields
+         * \return The text part of the response
+         */
+        std::string post_multipart(std::string_view url, ArrayProxy<FormField> fields);
+    };
 
     /**
      * \brief Check return code from mirai HTTP API in the response json object,
@@ -0,0 +1,73 @@
+#include "retry.h"
+#include <cstdint>
+#include <random>
+#include <algorithm>
+
+namespace mirai::utils
+{
+    std::chrono::milliseconds backoff_delay(const RetryPolicy& policy, const size_t retry)
+    {
+        thread_local std::minstd_rand engine{ std::random_device{}() };
+        double bound = double(policy.initial_backoff.count());
+        const double max = double(policy.max_backoff.count());
+        for (size_t i = 0; i < retry && bound < max; i++) bound *= policy.multiplier;
+        bound = std::clamp(bound, 0.0, max);
+        std::uniform_real_distribution<double> dist(0.0, bound);
+        return std::chrono::milliseconds(int64_t(dist(engine)));
+    }
+
+    std::chrono::milliseconds backoff_delay(const ReconnectPolicy& policy, const size_t attempt)
+    {
+        return backoff_delay(RetryPolicy{ 0, policy.initial_backoff, policy.max_backoff, policy.multiplier }, attempt);
+    }
+
+    void CircuitBreaker::set_state(const State state)
+    {
+        if (state == state_) return;
+        state_ = state;
+        generation_++;
+    }
+
+    CircuitBreaker::Admission CircuitBreaker::acquire(const CircuitBreakerPolicy& policy)
+    {
+        if (policy.failure_threshold == 0) return { Decision::allow, generation_ };
+        switch (state_)
+        {
+            case State::closed: return { Decision::allow, generation_ };
+            case State::open:
+                if (Clock::now() < open_until_) return { Decision::reject, generation_ };
+                set_state(State::half_open);
+                probing_ = true;
+                return { Decision::probe, generation_ };
+            case State::half_open:
+                if (probing_) return { Decision::reject, generation_ };
+                probing_ = true;
+                return { Decision::probe, generation_ };
+            default: return { Decision::allow, generation_ };
+        }
+    }
+
+    bool CircuitBreaker::record(const CircuitBreakerPolicy& policy, const Admission& admission, const bool success)
+    {
+        if (policy.failure_threshold == 0) return false;
+        // Let through before the last state change, e.g. while closed before tripping
+        if (admission.generation != generation_) return false;
+        probing_ = false;
+        if (success)
+        {
+            set_state(State::closed);
+            failures_ = 0;
+            return false;
+        }
+        // A failed probe reopens the breaker at once
+        if (state_ == State::half_open || ++failures_ >= policy.failure_threshold)
+        {
+            const bool tripped = state_ != State::open;
+            set_state(State::open);
+            open_until_ = Clock::now() + policy.open_duration;
+            failures_ = 0;
+            return tripped;
+        }
+        return false;
+    }
+}
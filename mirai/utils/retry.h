@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace mirai::utils
+{
+    /**
+     * \brief Policy of retrying failed idempotent requests
+     * \remarks The delay before the n-th retry is a random duration between zero and
+     * min(max_backoff, initial_backoff * multiplier ^ (n - 1)), i.e. exponential
+     * backoff with full jitter
+     */
+    struct RetryPolicy final
+    {
+        size_t max_attempts = 1; ///< Maximum attempts of a request including the first one, 1 for no retry
+        std::chrono::milliseconds initial_backoff{ 100 }; ///< Backoff upper bound before the first retry
+        std::chrono::milliseconds max_backoff{ 5000 }; ///< Maximum backoff upper bound
+        double multiplier = 2.0; ///< Growth factor of the backoff upper bound
+    };
+
+    /**
+     * \brief Policy of reestablishing dropped WebSocket connections
+     * \remarks The delay before the n-th attempt is the same jittered exponential
+     * backoff as the one of RetryPolicy
+     */
+    struct ReconnectPolicy final
+    {
+        size_t max_attempts = 0; ///< Maximum consecutive attempts after a connection drops, 0 to disable reconnection
+        std::chrono::milliseconds initial_backoff{ 500 }; ///< Backoff upper bound before the first attempt
+        std::chrono::milliseconds max_backoff{ 30000 }; ///< Maximum backoff upper bound
+        double multiplier = 2.0; ///< Growth factor of the backoff upper bound
+    };
+
+    /**
+     * \brief Policy of the circuit breakers, each endpoint has its own breaker
+     */
+    struct CircuitBreakerPolicy final
+    {
+        size_t failure_threshold = 0; ///< Consecutive failures to open the circuit, 0 to disable the breakers
+        std::chrono::milliseconds open_duration{ 5000 }; ///< Time to fail fast before probing the server again
+    };
+
+    /**
+     * \brief Get a jittered exponential backoff delay
+     * \param policy The retry policy
+     * \param retry Zero-based index of the retry
+     * \return The delay
+     */
+    std::chrono::milliseconds backoff_delay(const RetryPolicy& policy, size_t retry);
+
+    /**
+     * \brief Get a jittered exponential backoff delay
+     * \param policy The reconnection policy
+     * \param attempt Zero-based index of the reconnection attempt
+     * \return The delay
+     */
+    std::chrono::milliseconds backoff_delay(const ReconnectPolicy& policy, size_t attempt);
+
+    /**
+     * \brief A circuit breaker for a single endpoint
+     * \details The breaker counts consecutive failures while closed, and opens
+     * when the count reaches the threshold. Requests are rejected while the
+     * breaker is open. After the open duration, exactly one request is let
+     * through as a probe (half-open), its result closes or reopens the breaker.
+     * Results of requests let through before the last state change are ignored,
+     * so a late result cannot stand in for the result of the probe.
+     * \remarks This class is not thread safe
+     */
+    class CircuitBreaker final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * \brief State of a circuit breaker
+         */
+        enum class State { closed, open, half_open };
+
+        /**
+         * \brief Decision on whether to let a request through
+         */
+        enum class Decision { allow, probe, reject };
+
+        /**
+         * \brief A decision tagged with the state of the breaker it is made in
+         */
+        struct Admission
+        {
+            Decision decision = Decision::allow; ///< The decision
+            uint64_t generation = 0; ///< Amount of state changes of the breaker before the decision
+        };
+
+    private:
+        State state_ = State::closed;
+        uint64_t generation_ = 0;
+        size_t failures_ = 0;
+        Clock::time_point open_until_{};
+        bool probing_ = false;
+
+        void set_state(State state);
+
+    public:
+        /**
+         * \brief Decide whether a request should be sent
+         * \param policy The breaker policy
+         * \return The decision
+         */
+        Admission acquire(const CircuitBreakerPolicy& policy);
+
+        /**
+         * \brief Record the result of a request let through by acquire
+         * \param policy The breaker policy
+         * \param admission The admission of the request returned by acquire
+         * \param success Whether the request succeeded
+         * \return Whether the breaker has just opened because of this result
+         */
+        bool record(const CircuitBreakerPolicy& policy, const Admission& admission, bool success);
+
+        /**
+         * \brief Get the current state of the breaker
+         * \return The state
+         */
+        State state() const { return state_; }
+    };
+}
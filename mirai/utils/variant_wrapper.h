@@ -11,6 +11,14 @@ namespace mirai::utils
         struct in_variant<std::variant<Ts...>, T> :
             std::bool_constant<(std::is_same_v<Ts, T> || ...)> {};
         template <typename Var, typename T> constexpr bool in_variant_v = in_variant<Var, T>::value;
+
+        template <typename Var, typename T> struct variant_index {};
+        template <typename T, typename... Ts>
+        struct variant_index<std::variant<T, Ts...>, T> : std::integral_constant<size_t, 0> {};
+        template <typename U, typename... Ts, typename T>
+        struct variant_index<std::variant<U, Ts...>, T> :
+            std::integral_constant<size_t, 1 + variant_index<std::variant<Ts...>, T>::value> {};
+        template <typename Var, typename T> constexpr size_t variant_index_v = variant_index<Var, T>::value;
     }
 
     /**
@@ -103,6 +111,14 @@ namespace mirai::utils
          */
         Type type() const { return Type(data_.index()); }
 
+        /**
+         * \brief Get the type enum value corresponding to a type of object
+         * \tparam T The type of object
+         * \return The type
+         */
+        template <typename T>
+        static constexpr Type type_of() { return Type(detail::variant_index_v<VariantType, T>); }
+
         /**
          * \brief Check if two variants are equal
          * \param lhs The first variant